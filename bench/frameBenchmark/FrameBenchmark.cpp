@@ -0,0 +1,101 @@
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+// nearest rank, so every percentile is a frame that actually happened
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+
+    return sorted[std::min(std::max(rank, static_cast<size_t>(1)), sorted.size()) - 1];
+}
+
+static std::string escape(const std::string& text)
+{
+    std::string escaped;
+
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+void FrameBenchmark::addSample(const std::string& metric, double value)
+{
+    auto it = std::find_if(metrics.begin(), metrics.end(), [&metric](const auto& m) { return m.first == metric; });
+
+    if (it == metrics.end()) {
+        metrics.emplace_back(metric, std::vector<double>{});
+        it = metrics.end() - 1;
+    }
+
+    it->second.push_back(value);
+}
+
+MetricSummary FrameBenchmark::summarize(std::vector<double> samples)
+{
+    MetricSummary summary{};
+
+    if (samples.empty()) {
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    summary.p50 = percentile(samples, 50.0);
+    summary.p95 = percentile(samples, 95.0);
+    summary.p99 = percentile(samples, 99.0);
+
+    return summary;
+}
+
+void FrameBenchmark::writeJson(const std::string& path, const std::vector<std::pair<std::string, std::string>>& info) const
+{
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open benchmark results " + path + "!");
+    }
+
+    file << "{\n";
+
+    for (auto& field : info) {
+        file << "  \"" << escape(field.first) << "\": \"" << escape(field.second) << "\",\n";
+    }
+
+    file << "  \"metrics\": {";
+    file.precision(4);
+    file << std::fixed;
+
+    for (size_t i = 0; i < metrics.size(); i++) {
+        MetricSummary summary = summarize(metrics[i].second);
+
+        file << (i ? ",\n" : "\n");
+        file << "    \"" << escape(metrics[i].first) << "\": {"
+             << "\"samples\": " << metrics[i].second.size()
+             << ", \"min\": " << summary.min
+             << ", \"mean\": " << summary.mean
+             << ", \"p50\": " << summary.p50
+             << ", \"p95\": " << summary.p95
+             << ", \"p99\": " << summary.p99
+             << ", \"max\": " << summary.max << "}";
+    }
+
+    file << "\n  }\n}\n";
+
+    if (!file) {
+        throw std::runtime_error("failed to write benchmark results " + path + "!");
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef _FRAME_BENCHMARK_H_
+#define _FRAME_BENCHMARK_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct MetricSummary {
+    double min = 0.0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Collects one sample per frame and metric and writes their percentiles as JSON,
+// metrics keep the order they were first added in so reports diff cleanly
+class FrameBenchmark {
+public:
+    void addSample(const std::string& metric, double value);
+    static MetricSummary summarize(std::vector<double> samples);
+    // info is written verbatim as string fields next to the metrics
+    void writeJson(const std::string& path, const std::vector<std::pair<std::string, std::string>>& info) const;
+
+private:
+    std::vector<std::pair<std::string, std::vector<double>>> metrics;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "FrameBenchmark.h"
+#include "VulkanApp.h"
+#include "imgui.h"
+#include "imgui_impl_vulkan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+constexpr uint32_t BENCHMARK_WIDTH = 1024;
+constexpr uint32_t BENCHMARK_HEIGHT = 768;
+constexpr int BENCHMARK_ROWS = 48;
+constexpr int BENCHMARK_WAVE_POINTS = 128;
+
+// allocations through C++ operator new and ImGui's allocator, the per frame delta is reported.
+// Other C allocations, e.g. stb_image's or the driver's, go straight to malloc and aren't counted
+static std::atomic<uint64_t> heapAllocations{0};
+
+void* operator new(size_t size)
+{
+    void* ptr = malloc(size ? size : 1);
+
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// over-aligned types take these, they count the same
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    size_t align = static_cast<size_t>(alignment);
+    void* ptr = nullptr;
+
+    // aligned_alloc wants a size that is a multiple of the alignment
+    size = (std::max<size_t>(size, 1) + align - 1) / align * align;
+    ptr = aligned_alloc(align, size);
+
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    return ptr;
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    free(ptr);
+}
+
+// ImGui allocates through malloc by default, these take its allocations instead
+static void* countedImguiAlloc(size_t size, void*)
+{
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    return malloc(size);
+}
+
+static void countedImguiFree(void* ptr, void*)
+{
+    free(ptr);
+}
+
+// the same widgets in the same place every run, only driven by the frame number
+static void drawScriptedUi(uint32_t frame)
+{
+    float wave[BENCHMARK_WAVE_POINTS];
+
+    for (int i = 0; i < BENCHMARK_WAVE_POINTS; i++) {
+        wave[i] = sinf((frame + i) * 0.1f);
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(BENCHMARK_WIDTH - 420.0f, 20.0f), ImGuiCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(400.0f, BENCHMARK_HEIGHT - 40.0f), ImGuiCond_Always);
+    ImGui::Begin("Benchmark");
+    ImGui::Text("frame %u", frame);
+    ImGui::PlotLines("wave", wave, BENCHMARK_WAVE_POINTS, 0, nullptr, -1.0f, 1.0f, ImVec2(0.0f, 80.0f));
+    ImGui::ProgressBar((frame % 120) / 120.0f);
+    ImGui::Separator();
+
+    for (int i = 0; i < BENCHMARK_ROWS; i++) {
+        ImGui::Text("row %02d", i);
+        ImGui::SameLine(80.0f);
+        ImGui::Text("%8.3f", sinf(frame * 0.05f + i));
+    }
+
+    ImGui::End();
+}
+
+static void printUsage()
+{
+    std::cout << "usage: Benchmark [--frames N] [--warmup N] [--out FILE] [--window] [--validation] [--direct-geometry] [--bindless-textures]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frameCount = 600;
+    uint32_t warmupFrames = 60;
+    std::string outPath = "benchmark.json";
+    bool headless = true;
+    bool validation = false;
+    bool directGeometry = false;
+    bool bindlessTextures = false;
+    FrameBenchmark benchmark;
+    uint64_t lastHeapAllocations = 0;
+    uint64_t lastDeviceAllocations = 0;
+    uint32_t skippedFrames = 0;
+    VkPhysicalDeviceProperties properties{};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmupFrames = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--window") == 0) {
+            headless = false;
+        }
+        else if (strcmp(argv[i], "--validation") == 0) {
+            validation = true;
+        }
+        else if (strcmp(argv[i], "--direct-geometry") == 0) {
+            directGeometry = true;
+        }
+        else if (strcmp(argv[i], "--bindless-textures") == 0) {
+            bindlessTextures = true;
+        }
+        else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // before prepare() creates the ImGui context
+    ImGui::SetAllocatorFunctions(countedImguiAlloc, countedImguiFree);
+
+    try {
+        VulkanApp app(BENCHMARK_WIDTH, BENCHMARK_HEIGHT, "Vulkan benchmark", validation, headless);
+
+        app.setDirectImguiGeometry(directGeometry);
+        app.setBindlessImguiTextures(bindlessTextures);
+        app.prepare();
+        app.setUiScript(drawScriptedUi);
+        app.setFrameCallback([&](const FrameTiming& timing) {
+            // read first so the callback's own allocations count towards the next frame's baseline
+            uint64_t heap = heapAllocations.load(std::memory_order_relaxed);
+            uint64_t device = app.memoryAllocator.getStats().deviceAllocations;
+            ImGui_ImplVulkan_RenderStats imguiStats = ImGui_ImplVulkan_GetRenderStats();
+
+            // a swap chain recreation drew nothing, counted instead of sampled
+            if (timing.skipped) {
+                skippedFrames++;
+            }
+            else if (timing.frame >= warmupFrames) {
+                benchmark.addSample("cpu.frame_ms", timing.total);
+                benchmark.addSample("cpu.prepare_ms", timing.prepare);
+                benchmark.addSample("cpu.imgui_ms", timing.imgui);
+                benchmark.addSample("cpu.uniforms_ms", timing.uniforms);
+                benchmark.addSample("cpu.record_ms", timing.record);
+                benchmark.addSample("cpu.submit_ms", timing.submit);
+                benchmark.addSample("heap_allocations", static_cast<double>(heap - lastHeapAllocations));
+                benchmark.addSample("device_allocations", static_cast<double>(device - lastDeviceAllocations));
+                benchmark.addSample("imgui.draw_calls", imguiStats.DrawCalls);
+                benchmark.addSample("imgui.draws_saved", imguiStats.Commands - imguiStats.DrawCalls);
+                // bindless draws still push a texture index per change, those aren't saved
+                benchmark.addSample("imgui.binds_saved", imguiStats.Commands - imguiStats.DescriptorBinds - imguiStats.TextureIndexPushes);
+                benchmark.addSample("imgui.texture_index_pushes", imguiStats.TextureIndexPushes);
+                benchmark.addSample("imgui.scissors_saved", imguiStats.Commands - imguiStats.ScissorSets);
+
+                // results trail the CPU by the frames in flight, which the warm up hides
+                if (app.gpuProfiler.isSupported()) {
+                    for (auto& scope : app.gpuProfiler.getStats()) {
+                        benchmark.addSample("gpu." + scope.name + "_ms", scope.last);
+                    }
+                }
+            }
+
+            lastDeviceAllocations = device;
+            lastHeapAllocations = heapAllocations.load(std::memory_order_relaxed);
+        });
+
+        app.run(false, warmupFrames + frameCount);
+
+        vkGetPhysicalDeviceProperties(app.physicalDevice, &properties);
+
+        benchmark.writeJson(outPath, {{"device", properties.deviceName},
+                                      {"mode", headless ? "headless" : "window"},
+                                      {"imgui_geometry", ImGui_ImplVulkan_HasDirectGeometry() ? "direct" : "copied"},
+                                      {"imgui_textures", bindlessTextures && app.descriptorIndexingSupported ? "bindless" : "descriptor sets"},
+                                      {"extent", std::to_string(BENCHMARK_WIDTH) + "x" + std::to_string(BENCHMARK_HEIGHT)},
+                                      {"frames", std::to_string(frameCount)},
+                                      {"warmup", std::to_string(warmupFrames)},
+                                      {"skipped_frames", std::to_string(skippedFrames)}});
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "benchmark results written to " << outPath << std::endl;
+
+    return EXIT_SUCCESS;
+}
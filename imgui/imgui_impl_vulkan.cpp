@@ -48,26 +48,67 @@
 #include "imgui_impl_vulkan.h"
 
 #include "imgui.h"
+#include "imgui_internal.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
-// Reusable buffers used for rendering 1 current in-flight frame, for ImGui_ImplVulkan_RenderDrawData()
+// Vertex/index streaming ring used by ImGui_ImplVulkan_RenderDrawData()
+// One persistently mapped buffer split into a region per in-flight frame, each frame writes its vertices then its indices
+// into the next region. A frame outgrowing its region replaces the ring by one with regions at least twice as large,
+// so a growing UI settles after a few frames and the steady state costs only memcpy.
 // [Please zero-clear before use!]
-struct ImGui_ImplVulkanH_FrameRenderBuffers {
-    VkDeviceMemory VertexBufferMemory;
-    VkDeviceMemory IndexBufferMemory;
-    VkDeviceSize VertexBufferSize;
-    VkDeviceSize IndexBufferSize;
-    VkBuffer VertexBuffer;
-    VkBuffer IndexBuffer;
+struct ImGui_ImplVulkanH_StreamRing {
+    VkDeviceMemory Memory;
+    VkBuffer Buffer;
+    char* Mapped;
+    bool Coherent; // Otherwise written ranges are flushed
+    VkDeviceSize RegionSize;
+    uint32_t RegionCount;
+    uint32_t Index;
 };
 
-// Each viewport will hold 1 ImGui_ImplVulkanH_WindowRenderBuffers
+// Device-local, host-visible memory split into a region per in-flight frame, see ImGui_ImplVulkan_InitInfo::DirectGeometrySize.
+// Before each frame the draw lists that were drawn last frame get chunks of the next region as vertex/index storage, so
+// ImDrawList writes straight into memory the GPU reads and ImGui_ImplVulkan_RenderDrawData() only records offsets.
+// A list outgrowing its chunk moves to the heap for the rest of the frame and is copied into the stream ring as usual.
 // [Please zero-clear before use!]
-struct ImGui_ImplVulkanH_WindowRenderBuffers {
+struct ImGui_ImplVulkanH_DirectGeometry {
+    VkDeviceMemory Memory;
+    VkBuffer Buffer;
+    char* Mapped;
+    VkDeviceSize Size; // Of the whole mapping, which stays reserved for ImGui_ImplVulkan_MemFree() after the memory is freed
+    VkDeviceSize RegionSize;
+    uint32_t RegionCount;
     uint32_t Index;
-    uint32_t Count;
-    ImGui_ImplVulkanH_FrameRenderBuffers* FrameRenderBuffers;
+    VkDeviceSize Head; // Next free byte of the current region, from Mapped
+};
+
+// Where ImGui_ImplVulkan_RenderDrawData() finds a draw list's geometry, offsets are in elements from the bound buffer offsets
+struct ImGui_ImplVulkanH_DrawListSource {
+    bool Direct;
+    int VtxOffset;
+    int IdxOffset;
+};
+
+// One vkCmdDrawIndexed of ImGui_ImplVulkan_RenderDrawData(), covering consecutive ImDrawCmd that share texture, scissor
+// and geometry and whose indices follow each other, or a user callback
+struct ImGui_ImplVulkanH_Draw {
+    const ImDrawList* CmdList;
+    const ImDrawCmd* Callback; // NULL for draws
+    ImTextureID TextureId;
+    VkRect2D Scissor;
+    bool Direct;
+    uint32_t FirstIndex;
+    uint32_t ElemCount;
+    int32_t VertexOffset;
+};
+
+// A ring replaced by a larger one, frames in flight may still read from it
+struct ImGui_ImplVulkanH_RetiredStreamRing {
+    VkDeviceMemory Memory;
+    VkBuffer Buffer;
+    uint32_t FramesLeft; // Rendered frames before every frame that used it has retired
 };
 
 // Vulkan data
@@ -88,15 +129,27 @@ static VkDeviceMemory g_UploadBufferMemory = VK_NULL_HANDLE;
 static VkBuffer g_UploadBuffer = VK_NULL_HANDLE;
 
 // Render buffers
-static ImGui_ImplVulkanH_WindowRenderBuffers g_MainWindowRenderBuffers;
+static const VkDeviceSize g_StreamRingMinRegionSize = 64 * 1024;
+static ImGui_ImplVulkanH_StreamRing g_StreamRing = {};
+static ImVector<ImGui_ImplVulkanH_RetiredStreamRing> g_RetiredStreamRings;
+static ImGui_ImplVulkanH_DirectGeometry g_DirectGeometry = {};
+static ImVector<ImGui_ImplVulkanH_DrawListSource> g_DrawListSources;
+static ImVector<ImGui_ImplVulkanH_Draw> g_Draws;
+
+// Bindless textures, see ImGui_ImplVulkan_InitInfo::BindlessTextureCount
+static VkDescriptorPool g_BindlessPool = VK_NULL_HANDLE;
+static VkDescriptorSet g_BindlessSet = VK_NULL_HANDLE;
+static uint32_t g_BindlessNextSlot = 1; // Slot 0 stays empty, so no ImTextureID is NULL
+static ImVector<uint32_t> g_BindlessFreeSlots;
+static ImGui_ImplVulkan_RenderStats g_RenderStats = {};
 
 // Forward Declarations
 bool ImGui_ImplVulkan_CreateDeviceObjects();
 void ImGui_ImplVulkan_DestroyDeviceObjects();
 void ImGui_ImplVulkanH_DestroyFrame(VkDevice device, ImGui_ImplVulkanH_Frame* fd, const VkAllocationCallbacks* allocator);
 void ImGui_ImplVulkanH_DestroyFrameSemaphores(VkDevice device, ImGui_ImplVulkanH_FrameSemaphores* fsd, const VkAllocationCallbacks* allocator);
-void ImGui_ImplVulkanH_DestroyFrameRenderBuffers(VkDevice device, ImGui_ImplVulkanH_FrameRenderBuffers* buffers, const VkAllocationCallbacks* allocator);
-void ImGui_ImplVulkanH_DestroyWindowRenderBuffers(VkDevice device, ImGui_ImplVulkanH_WindowRenderBuffers* buffers, const VkAllocationCallbacks* allocator);
+void ImGui_ImplVulkanH_DestroyStreamRings(VkDevice device, const VkAllocationCallbacks* allocator);
+void ImGui_ImplVulkanH_DestroyDirectGeometry(VkDevice device, const VkAllocationCallbacks* allocator);
 void ImGui_ImplVulkanH_CreateWindowSwapChain(VkPhysicalDevice physical_device, VkDevice device, ImGui_ImplVulkanH_Window* wd, const VkAllocationCallbacks* allocator, int w, int h, uint32_t min_image_count);
 void ImGui_ImplVulkanH_CreateWindowCommandBuffers(VkPhysicalDevice physical_device, VkDevice device, ImGui_ImplVulkanH_Window* wd, uint32_t queue_family, const VkAllocationCallbacks* allocator);
 
@@ -207,6 +260,59 @@ static uint32_t __glsl_shader_frag_spv[] =
         0x00000007, 0x0000001d, 0x00000012, 0x0000001c, 0x0003003e, 0x00000009, 0x0000001d, 0x000100fd,
         0x00010038};
 
+// glsl_shader_bindless.frag, for ImGui_ImplVulkan_InitInfo::BindlessTextureCount, compiled with:
+// # glslangValidator -V -x -o glsl_shader_bindless.frag.u32 glsl_shader_bindless.frag
+// (pc.uTexture is dynamically uniform, so indexing needs shaderSampledImageArrayDynamicIndexing but no nonuniformEXT)
+/*
+#version 450 core
+layout(constant_id = 0) const uint TEXTURE_COUNT = 1;
+layout(location = 0) out vec4 fColor;
+layout(set=0, binding=0) uniform sampler2D sTextures[TEXTURE_COUNT];
+layout(push_constant) uniform uPushConstant { layout(offset = 16) uint uTexture; } pc;
+layout(location = 0) in struct { vec4 Color; vec2 UV; } In;
+void main()
+{
+    fColor = In.Color * texture(sTextures[pc.uTexture], In.UV.st);
+}
+*/
+static uint32_t __glsl_shader_bindless_frag_spv[] =
+    {
+        0x07230203, 0x00010000, 0x00080001, 0x00000029, 0x00000000, 0x00020011, 0x00000001, 0x00020011,
+        0x0000001d, 0x0006000b, 0x00000001, 0x4c534c47, 0x6474732e, 0x3035342e, 0x00000000, 0x0003000e,
+        0x00000000, 0x00000001, 0x0007000f, 0x00000004, 0x00000002, 0x6e69616d, 0x00000000, 0x00000003,
+        0x00000004, 0x00030010, 0x00000002, 0x00000007, 0x00030003, 0x00000002, 0x000001c2, 0x00040005,
+        0x00000002, 0x6e69616d, 0x00000000, 0x00040005, 0x00000003, 0x6c6f4366, 0x0000726f, 0x00030005,
+        0x00000005, 0x00000000, 0x00050006, 0x00000005, 0x00000000, 0x6f6c6f43, 0x00000072, 0x00040006,
+        0x00000005, 0x00000001, 0x00005655, 0x00030005, 0x00000004, 0x00006e49, 0x00060005, 0x00000006,
+        0x54584554, 0x5f455255, 0x4e554f43, 0x00000054, 0x00050005, 0x00000007, 0x78655473, 0x65727574,
+        0x00000073, 0x00060005, 0x00000008, 0x73755075, 0x6e6f4368, 0x6e617473, 0x00000074, 0x00060006,
+        0x00000008, 0x00000000, 0x78655475, 0x65727574, 0x00000000, 0x00030005, 0x00000009, 0x00006370,
+        0x00040047, 0x00000003, 0x0000001e, 0x00000000, 0x00040047, 0x00000004, 0x0000001e, 0x00000000,
+        0x00040047, 0x00000006, 0x00000001, 0x00000000, 0x00040047, 0x00000007, 0x00000022, 0x00000000,
+        0x00040047, 0x00000007, 0x00000021, 0x00000000, 0x00050048, 0x00000008, 0x00000000, 0x00000023,
+        0x00000010, 0x00030047, 0x00000008, 0x00000002, 0x00020013, 0x0000000a, 0x00030021, 0x0000000b,
+        0x0000000a, 0x00030016, 0x0000000c, 0x00000020, 0x00040017, 0x0000000d, 0x0000000c, 0x00000004,
+        0x00040020, 0x0000000e, 0x00000003, 0x0000000d, 0x0004003b, 0x0000000e, 0x00000003, 0x00000003,
+        0x00040017, 0x0000000f, 0x0000000c, 0x00000002, 0x0004001e, 0x00000005, 0x0000000d, 0x0000000f,
+        0x00040020, 0x00000010, 0x00000001, 0x00000005, 0x0004003b, 0x00000010, 0x00000004, 0x00000001,
+        0x00040015, 0x00000011, 0x00000020, 0x00000001, 0x0004002b, 0x00000011, 0x00000012, 0x00000000,
+        0x00040020, 0x00000013, 0x00000001, 0x0000000d, 0x00090019, 0x00000014, 0x0000000c, 0x00000001,
+        0x00000000, 0x00000000, 0x00000000, 0x00000001, 0x00000000, 0x0003001b, 0x00000015, 0x00000014,
+        0x00040015, 0x00000016, 0x00000020, 0x00000000, 0x00040032, 0x00000016, 0x00000006, 0x00000001,
+        0x0004001c, 0x00000017, 0x00000015, 0x00000006, 0x00040020, 0x00000018, 0x00000000, 0x00000017,
+        0x0004003b, 0x00000018, 0x00000007, 0x00000000, 0x0003001e, 0x00000008, 0x00000016, 0x00040020,
+        0x00000019, 0x00000009, 0x00000008, 0x0004003b, 0x00000019, 0x00000009, 0x00000009, 0x00040020,
+        0x0000001a, 0x00000009, 0x00000016, 0x00040020, 0x0000001b, 0x00000000, 0x00000015, 0x0004002b,
+        0x00000011, 0x0000001c, 0x00000001, 0x00040020, 0x0000001d, 0x00000001, 0x0000000f, 0x00050036,
+        0x0000000a, 0x00000002, 0x00000000, 0x0000000b, 0x000200f8, 0x0000001e, 0x00050041, 0x00000013,
+        0x0000001f, 0x00000004, 0x00000012, 0x0004003d, 0x0000000d, 0x00000020, 0x0000001f, 0x00050041,
+        0x0000001a, 0x00000021, 0x00000009, 0x00000012, 0x0004003d, 0x00000016, 0x00000022, 0x00000021,
+        0x00050041, 0x0000001b, 0x00000023, 0x00000007, 0x00000022, 0x0004003d, 0x00000015, 0x00000024,
+        0x00000023, 0x00050041, 0x0000001d, 0x00000025, 0x00000004, 0x0000001c, 0x0004003d, 0x0000000f,
+        0x00000026, 0x00000025, 0x00050057, 0x0000000d, 0x00000027, 0x00000024, 0x00000026, 0x00050085,
+        0x0000000d, 0x00000028, 0x00000020, 0x00000027, 0x0003003e, 0x00000003, 0x00000028, 0x000100fd,
+        0x00010038};
+
 //-----------------------------------------------------------------------------
 // FUNCTIONS
 //-----------------------------------------------------------------------------
@@ -229,54 +335,218 @@ static void check_vk_result(VkResult err)
         v->CheckVkResultFn(err);
 }
 
-static void CreateOrResizeBuffer(VkBuffer& buffer, VkDeviceMemory& buffer_memory, VkDeviceSize& p_buffer_size, size_t new_size, VkBufferUsageFlagBits usage)
+// Replaces the streaming ring by one whose regions hold at least required_region_size bytes.
+// The old ring is retired rather than destroyed as in-flight frames may still be reading from it.
+static void GrowStreamRing(VkDeviceSize required_region_size)
 {
     ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
+    ImGui_ImplVulkanH_StreamRing* ring = &g_StreamRing;
     VkResult err;
-    if (buffer != VK_NULL_HANDLE)
-        vkDestroyBuffer(v->Device, buffer, v->Allocator);
-    if (buffer_memory != VK_NULL_HANDLE)
-        vkFreeMemory(v->Device, buffer_memory, v->Allocator);
 
-    VkDeviceSize vertex_buffer_size_aligned = ((new_size - 1) / g_BufferMemoryAlignment + 1) * g_BufferMemoryAlignment;
+    if (ring->Buffer != VK_NULL_HANDLE) {
+        ImGui_ImplVulkanH_RetiredStreamRing retired;
+        retired.Memory = ring->Memory;
+        retired.Buffer = ring->Buffer;
+        retired.FramesLeft = ring->RegionCount;
+        g_RetiredStreamRings.push_back(retired);
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(v->PhysicalDevice, &properties);
+
+    // Regions start on boundaries valid for buffer offsets and for non-coherent flushes
+    VkDeviceSize alignment = (g_BufferMemoryAlignment > properties.limits.nonCoherentAtomSize) ? g_BufferMemoryAlignment : properties.limits.nonCoherentAtomSize;
+    VkDeviceSize region_size = (ring->RegionSize * 2 > g_StreamRingMinRegionSize) ? ring->RegionSize * 2 : g_StreamRingMinRegionSize;
+    while (region_size < required_region_size)
+        region_size *= 2;
+    region_size = ((region_size - 1) / alignment + 1) * alignment;
+
     VkBufferCreateInfo buffer_info = {};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buffer_info.size = vertex_buffer_size_aligned;
-    buffer_info.usage = usage;
+    buffer_info.size = region_size * v->ImageCount;
+    buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    err = vkCreateBuffer(v->Device, &buffer_info, v->Allocator, &buffer);
+    err = vkCreateBuffer(v->Device, &buffer_info, v->Allocator, &ring->Buffer);
     check_vk_result(err);
 
     VkMemoryRequirements req;
-    vkGetBufferMemoryRequirements(v->Device, buffer, &req);
+    vkGetBufferMemoryRequirements(v->Device, ring->Buffer, &req);
     g_BufferMemoryAlignment = (g_BufferMemoryAlignment > req.alignment) ? g_BufferMemoryAlignment : req.alignment;
     VkMemoryAllocateInfo alloc_info = {};
     alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     alloc_info.allocationSize = req.size;
-    alloc_info.memoryTypeIndex = ImGui_ImplVulkan_MemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-    err = vkAllocateMemory(v->Device, &alloc_info, v->Allocator, &buffer_memory);
+    alloc_info.memoryTypeIndex = ImGui_ImplVulkan_MemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, req.memoryTypeBits);
+    ring->Coherent = alloc_info.memoryTypeIndex != 0xFFFFFFFF;
+    if (!ring->Coherent)
+        alloc_info.memoryTypeIndex = ImGui_ImplVulkan_MemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
+    err = vkAllocateMemory(v->Device, &alloc_info, v->Allocator, &ring->Memory);
+    check_vk_result(err);
+
+    err = vkBindBufferMemory(v->Device, ring->Buffer, ring->Memory, 0);
     check_vk_result(err);
 
-    err = vkBindBufferMemory(v->Device, buffer, buffer_memory, 0);
+    // Mapped for the ring's whole lifetime, freeing the memory unmaps it
+    err = vkMapMemory(v->Device, ring->Memory, 0, VK_WHOLE_SIZE, 0, (void**)(&ring->Mapped));
     check_vk_result(err);
-    p_buffer_size = new_size;
+
+    ring->RegionSize = region_size;
+    ring->RegionCount = v->ImageCount;
+    ring->Index = 0;
+}
+
+static bool ImGui_ImplVulkan_IsDirectGeometry(const void* ptr, VkDeviceSize size)
+{
+    ImGui_ImplVulkanH_DirectGeometry* dg = &g_DirectGeometry;
+    return dg->Mapped != NULL && (const char*)ptr >= dg->Mapped && (const char*)ptr + size <= dg->Mapped + dg->Size;
+}
+
+// Whether a draw list's storage lies in the region of the frame being rendered
+static bool ImGui_ImplVulkan_IsCurrentDirectGeometry(const void* ptr, VkDeviceSize size)
+{
+    ImGui_ImplVulkanH_DirectGeometry* dg = &g_DirectGeometry;
+    if (dg->Buffer == VK_NULL_HANDLE || ptr == NULL)
+        return false;
+    const char* region = dg->Mapped + dg->Index * dg->RegionSize;
+    return (const char*)ptr >= region && (const char*)ptr + size <= region + dg->RegionSize;
+}
+
+// ImGui's allocator functions while direct geometry is in use: storage handed to draw lists is never freed, which also
+// covers copies of it left in ImDrawListSplitter channels
+static void* ImGui_ImplVulkan_MemAlloc(size_t size, void* user_data)
+{
+    IM_UNUSED(user_data);
+    return malloc(size);
+}
+
+static void ImGui_ImplVulkan_MemFree(void* ptr, void* user_data)
+{
+    IM_UNUSED(user_data);
+    if (!ImGui_ImplVulkan_IsDirectGeometry(ptr, 0))
+        free(ptr);
+}
+
+static void CreateDirectGeometry()
+{
+    ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
+    ImGui_ImplVulkanH_DirectGeometry* dg = &g_DirectGeometry;
+    VkResult err;
+
+    VkDeviceSize region_size = ((v->DirectGeometrySize - 1) / g_BufferMemoryAlignment + 1) * g_BufferMemoryAlignment;
+    VkBufferCreateInfo buffer_info = {};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = region_size * v->ImageCount;
+    buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    err = vkCreateBuffer(v->Device, &buffer_info, v->Allocator, &dg->Buffer);
+    check_vk_result(err);
+
+    // Without a device-local, host-visible type whose heap holds the buffer with room to spare (ReBAR, or the 256MB BAR
+    // window for small sizes), draw lists keep their heap storage
+    VkMemoryRequirements req;
+    vkGetBufferMemoryRequirements(v->Device, dg->Buffer, &req);
+    VkPhysicalDeviceMemoryProperties prop;
+    vkGetPhysicalDeviceMemoryProperties(v->PhysicalDevice, &prop);
+    uint32_t memory_type = ImGui_ImplVulkan_MemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, req.memoryTypeBits);
+    if (memory_type == 0xFFFFFFFF || prop.memoryHeaps[prop.memoryTypes[memory_type].heapIndex].size < req.size * 4) {
+        vkDestroyBuffer(v->Device, dg->Buffer, v->Allocator);
+        dg->Buffer = VK_NULL_HANDLE;
+        return;
+    }
+
+    VkMemoryAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = req.size;
+    alloc_info.memoryTypeIndex = memory_type;
+    err = vkAllocateMemory(v->Device, &alloc_info, v->Allocator, &dg->Memory);
+    check_vk_result(err);
+
+    err = vkBindBufferMemory(v->Device, dg->Buffer, dg->Memory, 0);
+    check_vk_result(err);
+
+    err = vkMapMemory(v->Device, dg->Memory, 0, VK_WHOLE_SIZE, 0, (void**)(&dg->Mapped));
+    check_vk_result(err);
+
+    dg->Size = buffer_info.size;
+    dg->RegionSize = region_size;
+    dg->RegionCount = v->ImageCount;
+    dg->Index = 0;
+    dg->Head = 0;
+
+    ImGui::SetAllocatorFunctions(ImGui_ImplVulkan_MemAlloc, ImGui_ImplVulkan_MemFree);
+}
+
+// Drops a draw list buffer's storage if it lies in a region
+template <typename T>
+static void ImGui_ImplVulkan_ReleaseDirectGeometry(ImVector<T>& buffer)
+{
+    if (ImGui_ImplVulkan_IsDirectGeometry(buffer.Data, 0)) {
+        buffer.Data = NULL;
+        buffer.Size = buffer.Capacity = 0;
+    }
+}
+
+// Gives a draw list buffer a chunk of the current region, holding half as much again as it did last frame
+template <typename T>
+static void ImGui_ImplVulkan_SeedDirectGeometry(ImVector<T>& buffer)
+{
+    ImGui_ImplVulkanH_DirectGeometry* dg = &g_DirectGeometry;
+    int capacity = buffer.Size + buffer.Size / 2 + 64;
+    VkDeviceSize offset = (dg->Head + sizeof(T) - 1) / sizeof(T) * sizeof(T); // Draws address chunks in elements of T
+    bool fits = offset + capacity * sizeof(T) <= (dg->Index + 1) * dg->RegionSize;
+
+    if (!fits) {
+        ImGui_ImplVulkan_ReleaseDirectGeometry(buffer);
+        return;
+    }
+
+    buffer.clear();
+    buffer.Data = (T*)(dg->Mapped + offset);
+    buffer.Capacity = capacity;
+    dg->Head = offset + capacity * sizeof(T);
+}
+
+static void ImGui_ImplVulkan_NewDirectGeometryFrame()
+{
+    ImGuiContext& g = *GImGui;
+    ImGui_ImplVulkanH_DirectGeometry* dg = &g_DirectGeometry;
+
+    dg->Index = (dg->Index + 1) % dg->RegionCount;
+    dg->Head = dg->Index * dg->RegionSize;
+
+    // Called before ImGui::NewFrame(), so Active still tells which windows were drawn last frame. The others must not keep
+    // storage in a region another frame may be using.
+    for (int n = 0; n < g.Windows.Size; n++) {
+        ImDrawList* draw_list = g.Windows[n]->DrawList;
+        if (g.Windows[n]->Active) {
+            ImGui_ImplVulkan_SeedDirectGeometry(draw_list->VtxBuffer);
+            ImGui_ImplVulkan_SeedDirectGeometry(draw_list->IdxBuffer);
+            continue;
+        }
+        ImGui_ImplVulkan_ReleaseDirectGeometry(draw_list->VtxBuffer);
+        ImGui_ImplVulkan_ReleaseDirectGeometry(draw_list->IdxBuffer);
+    }
+    ImGui_ImplVulkan_SeedDirectGeometry(g.BackgroundDrawList.VtxBuffer);
+    ImGui_ImplVulkan_SeedDirectGeometry(g.BackgroundDrawList.IdxBuffer);
+    ImGui_ImplVulkan_SeedDirectGeometry(g.ForegroundDrawList.VtxBuffer);
+    ImGui_ImplVulkan_SeedDirectGeometry(g.ForegroundDrawList.IdxBuffer);
 }
 
-static void ImGui_ImplVulkan_SetupRenderState(ImDrawData* draw_data, VkCommandBuffer command_buffer, ImGui_ImplVulkanH_FrameRenderBuffers* rb, int fb_width, int fb_height)
+static void ImGui_ImplVulkan_BindGeometry(VkCommandBuffer command_buffer, bool direct, VkDeviceSize vertex_offset, VkDeviceSize index_offset)
+{
+    VkBuffer buffer = direct ? g_DirectGeometry.Buffer : g_StreamRing.Buffer;
+    VkDeviceSize vertex_offsets[1] = {direct ? 0 : vertex_offset};
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer, vertex_offsets);
+    vkCmdBindIndexBuffer(command_buffer, buffer, direct ? 0 : index_offset, sizeof(ImDrawIdx) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+}
+
+// Vertex and index buffers are bound per draw list, see ImGui_ImplVulkan_BindGeometry()
+static void ImGui_ImplVulkan_SetupRenderState(ImDrawData* draw_data, VkCommandBuffer command_buffer, int fb_width, int fb_height)
 {
     // Bind pipeline:
     {
         vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g_Pipeline);
     }
 
-    // Bind Vertex And Index Buffer:
-    if (draw_data->TotalVtxCount > 0) {
-        VkBuffer vertex_buffers[1] = {rb->VertexBuffer};
-        VkDeviceSize vertex_offset[1] = {0};
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, vertex_offset);
-        vkCmdBindIndexBuffer(command_buffer, rb->IndexBuffer, 0, sizeof(ImDrawIdx) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
-    }
-
     // Setup viewport:
     {
         VkViewport viewport;
@@ -314,112 +584,206 @@ void ImGui_ImplVulkan_RenderDrawData(ImDrawData* draw_data, VkCommandBuffer comm
         return;
 
     ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
+    ImGui_ImplVulkanH_StreamRing* ring = &g_StreamRing;
+
+    // Free the rings replaced by growth once no frame can still be reading from them
+    for (int n = 0; n < g_RetiredStreamRings.Size;) {
+        ImGui_ImplVulkanH_RetiredStreamRing* retired = &g_RetiredStreamRings[n];
+        if (--retired->FramesLeft > 0) {
+            n++;
+            continue;
+        }
+        vkDestroyBuffer(v->Device, retired->Buffer, v->Allocator);
+        vkFreeMemory(v->Device, retired->Memory, v->Allocator);
+        g_RetiredStreamRings.erase(retired);
+    }
 
-    // Allocate array to store enough vertex/index buffers
-    ImGui_ImplVulkanH_WindowRenderBuffers* wrb = &g_MainWindowRenderBuffers;
-    if (wrb->FrameRenderBuffers == NULL) {
-        wrb->Index = 0;
-        wrb->Count = v->ImageCount;
-        wrb->FrameRenderBuffers = (ImGui_ImplVulkanH_FrameRenderBuffers*)IM_ALLOC(sizeof(ImGui_ImplVulkanH_FrameRenderBuffers) * wrb->Count);
-        memset(wrb->FrameRenderBuffers, 0, sizeof(ImGui_ImplVulkanH_FrameRenderBuffers) * wrb->Count);
+    // Lists whose storage lies in this frame's direct geometry region are drawn in place, the others are copied
+    g_DrawListSources.resize(draw_data->CmdListsCount);
+    size_t vertex_size = 0;
+    size_t index_size = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++) {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        ImGui_ImplVulkanH_DrawListSource* source = &g_DrawListSources[n];
+        source->Direct = ImGui_ImplVulkan_IsCurrentDirectGeometry(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.size_in_bytes()) &&
+                         ImGui_ImplVulkan_IsCurrentDirectGeometry(cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.size_in_bytes());
+        if (source->Direct) {
+            source->VtxOffset = (int)(((const char*)cmd_list->VtxBuffer.Data - g_DirectGeometry.Mapped) / sizeof(ImDrawVert));
+            source->IdxOffset = (int)(((const char*)cmd_list->IdxBuffer.Data - g_DirectGeometry.Mapped) / sizeof(ImDrawIdx));
+            continue;
+        }
+        source->VtxOffset = (int)(vertex_size / sizeof(ImDrawVert));
+        source->IdxOffset = (int)(index_size / sizeof(ImDrawIdx));
+        vertex_size += cmd_list->VtxBuffer.size_in_bytes();
+        index_size += cmd_list->IdxBuffer.size_in_bytes();
     }
-    IM_ASSERT(wrb->Count == v->ImageCount);
-    wrb->Index = (wrb->Index + 1) % wrb->Count;
-    ImGui_ImplVulkanH_FrameRenderBuffers* rb = &wrb->FrameRenderBuffers[wrb->Index];
-
-    if (draw_data->TotalVtxCount > 0) {
-        // Create or resize the vertex/index buffers
-        size_t vertex_size = draw_data->TotalVtxCount * sizeof(ImDrawVert);
-        size_t index_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
-        if (rb->VertexBuffer == VK_NULL_HANDLE || rb->VertexBufferSize < vertex_size)
-            CreateOrResizeBuffer(rb->VertexBuffer, rb->VertexBufferMemory, rb->VertexBufferSize, vertex_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-        if (rb->IndexBuffer == VK_NULL_HANDLE || rb->IndexBufferSize < index_size)
-            CreateOrResizeBuffer(rb->IndexBuffer, rb->IndexBufferMemory, rb->IndexBufferSize, index_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-
-        // Upload vertex/index data into a single contiguous GPU buffer
-        ImDrawVert* vtx_dst = NULL;
-        ImDrawIdx* idx_dst = NULL;
-        VkResult err = vkMapMemory(v->Device, rb->VertexBufferMemory, 0, vertex_size, 0, (void**)(&vtx_dst));
-        check_vk_result(err);
-        err = vkMapMemory(v->Device, rb->IndexBufferMemory, 0, index_size, 0, (void**)(&idx_dst));
-        check_vk_result(err);
+
+    // Copied indices are rebased onto the first copied vertex when they still fit ImDrawIdx, so every copied list shares
+    // one vertex offset and draws can merge across lists
+    bool rebase_indices = sizeof(ImDrawIdx) == 4 || vertex_size / sizeof(ImDrawVert) <= 0x10000;
+
+    VkDeviceSize vertex_offset = 0;
+    VkDeviceSize index_offset = 0;
+    if (vertex_size > 0) {
+        // Indices follow the vertices of the frame's region, aligned to the index size
+        VkDeviceSize index_start = ((vertex_size - 1) / sizeof(ImDrawIdx) + 1) * sizeof(ImDrawIdx);
+        if (ring->Buffer == VK_NULL_HANDLE || index_start + index_size > ring->RegionSize)
+            GrowStreamRing(index_start + index_size);
+        IM_ASSERT(ring->RegionCount == v->ImageCount);
+        ring->Index = (ring->Index + 1) % ring->RegionCount;
+        vertex_offset = ring->Index * ring->RegionSize;
+        index_offset = vertex_offset + index_start;
+
+        // Upload vertex/index data into the frame's region
+        ImDrawVert* vtx_dst = (ImDrawVert*)(ring->Mapped + vertex_offset);
+        ImDrawIdx* idx_dst = (ImDrawIdx*)(ring->Mapped + index_offset);
         for (int n = 0; n < draw_data->CmdListsCount; n++) {
             const ImDrawList* cmd_list = draw_data->CmdLists[n];
+            ImGui_ImplVulkanH_DrawListSource* source = &g_DrawListSources[n];
+            if (source->Direct)
+                continue;
             memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-            memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+            if (rebase_indices && source->VtxOffset > 0) {
+                for (int i = 0; i < cmd_list->IdxBuffer.Size; i++)
+                    idx_dst[i] = (ImDrawIdx)(cmd_list->IdxBuffer.Data[i] + source->VtxOffset);
+            }
+            else
+                memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+            if (rebase_indices)
+                source->VtxOffset = 0;
             vtx_dst += cmd_list->VtxBuffer.Size;
             idx_dst += cmd_list->IdxBuffer.Size;
         }
-        VkMappedMemoryRange range[2] = {};
-        range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range[0].memory = rb->VertexBufferMemory;
-        range[0].size = VK_WHOLE_SIZE;
-        range[1].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range[1].memory = rb->IndexBufferMemory;
-        range[1].size = VK_WHOLE_SIZE;
-        err = vkFlushMappedMemoryRanges(v->Device, 2, range);
-        check_vk_result(err);
-        vkUnmapMemory(v->Device, rb->VertexBufferMemory);
-        vkUnmapMemory(v->Device, rb->IndexBufferMemory);
+        if (!ring->Coherent) {
+            // Regions are atom aligned, so flushing the whole region stays within the allocation
+            VkMappedMemoryRange range = {};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = ring->Memory;
+            range.offset = vertex_offset;
+            range.size = ring->RegionSize;
+            VkResult err = vkFlushMappedMemoryRanges(v->Device, 1, &range);
+            check_vk_result(err);
+        }
     }
 
-    // Setup desired Vulkan state
-    ImGui_ImplVulkan_SetupRenderState(draw_data, command_buffer, rb, fb_width, fb_height);
-
     // Will project scissor/clipping rectangles into framebuffer space
     ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
     ImVec2 clip_scale = draw_data->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
 
-    // Render command lists
-    // (Because we merged all buffers into a single one, we maintain our own offset into them)
-    int global_vtx_offset = 0;
-    int global_idx_offset = 0;
+    // Build the draws, merging a command into the previous draw when it uses the same texture, scissor and buffer and its
+    // indices continue the previous ones with the same vertex offset
+    // (Lists are either in the stream ring or in place in the direct geometry buffer, each source keeps its offsets into them)
+    ImGui_ImplVulkan_RenderStats* stats = &g_RenderStats;
+    memset(stats, 0, sizeof(*stats));
+    g_Draws.resize(0);
     for (int n = 0; n < draw_data->CmdListsCount; n++) {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        const ImGui_ImplVulkanH_DrawListSource* source = &g_DrawListSources[n];
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++) {
             const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+            ImGui_ImplVulkanH_Draw draw = {};
+            draw.CmdList = cmd_list;
             if (pcmd->UserCallback != NULL) {
-                // User callback, registered via ImDrawList::AddCallback()
-                // (ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.)
-                if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
-                    ImGui_ImplVulkan_SetupRenderState(draw_data, command_buffer, rb, fb_width, fb_height);
-                else
-                    pcmd->UserCallback(cmd_list, pcmd);
+                draw.Callback = pcmd;
+                g_Draws.push_back(draw);
+                continue;
             }
-            else {
-                // Project scissor/clipping rectangles into framebuffer space
-                ImVec4 clip_rect;
-                clip_rect.x = (pcmd->ClipRect.x - clip_off.x) * clip_scale.x;
-                clip_rect.y = (pcmd->ClipRect.y - clip_off.y) * clip_scale.y;
-                clip_rect.z = (pcmd->ClipRect.z - clip_off.x) * clip_scale.x;
-                clip_rect.w = (pcmd->ClipRect.w - clip_off.y) * clip_scale.y;
-
-                if (clip_rect.x < fb_width && clip_rect.y < fb_height && clip_rect.z >= 0.0f && clip_rect.w >= 0.0f) {
-                    // Negative offsets are illegal for vkCmdSetScissor
-                    if (clip_rect.x < 0.0f)
-                        clip_rect.x = 0.0f;
-                    if (clip_rect.y < 0.0f)
-                        clip_rect.y = 0.0f;
-
-                    // Apply scissor/clipping rectangle
-                    VkRect2D scissor;
-                    scissor.offset.x = (int32_t)(clip_rect.x);
-                    scissor.offset.y = (int32_t)(clip_rect.y);
-                    scissor.extent.width = (uint32_t)(clip_rect.z - clip_rect.x);
-                    scissor.extent.height = (uint32_t)(clip_rect.w - clip_rect.y);
-                    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
-
-                    // Bind descriptorset with font or user texture
-                    VkDescriptorSet desc_set[1] = {(VkDescriptorSet)pcmd->TextureId};
-                    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g_PipelineLayout, 0, 1, desc_set, 0, NULL);
-
-                    // Draw
-                    vkCmdDrawIndexed(command_buffer, pcmd->ElemCount, 1, pcmd->IdxOffset + global_idx_offset, pcmd->VtxOffset + global_vtx_offset, 0);
-                }
+
+            // Project scissor/clipping rectangles into framebuffer space
+            ImVec4 clip_rect;
+            clip_rect.x = (pcmd->ClipRect.x - clip_off.x) * clip_scale.x;
+            clip_rect.y = (pcmd->ClipRect.y - clip_off.y) * clip_scale.y;
+            clip_rect.z = (pcmd->ClipRect.z - clip_off.x) * clip_scale.x;
+            clip_rect.w = (pcmd->ClipRect.w - clip_off.y) * clip_scale.y;
+            if (clip_rect.x >= fb_width || clip_rect.y >= fb_height || clip_rect.z < 0.0f || clip_rect.w < 0.0f)
+                continue;
+
+            // Negative offsets are illegal for vkCmdSetScissor
+            if (clip_rect.x < 0.0f)
+                clip_rect.x = 0.0f;
+            if (clip_rect.y < 0.0f)
+                clip_rect.y = 0.0f;
+
+            draw.Scissor.offset.x = (int32_t)(clip_rect.x);
+            draw.Scissor.offset.y = (int32_t)(clip_rect.y);
+            draw.Scissor.extent.width = (uint32_t)(clip_rect.z - clip_rect.x);
+            draw.Scissor.extent.height = (uint32_t)(clip_rect.w - clip_rect.y);
+            draw.TextureId = pcmd->TextureId;
+            draw.Direct = source->Direct;
+            draw.FirstIndex = pcmd->IdxOffset + source->IdxOffset;
+            draw.ElemCount = pcmd->ElemCount;
+            draw.VertexOffset = pcmd->VtxOffset + source->VtxOffset;
+            stats->Commands++;
+
+            ImGui_ImplVulkanH_Draw* last = g_Draws.Size > 0 ? &g_Draws.back() : NULL;
+            if (last != NULL && last->Callback == NULL && last->TextureId == draw.TextureId && last->Direct == draw.Direct &&
+                last->VertexOffset == draw.VertexOffset && last->FirstIndex + last->ElemCount == draw.FirstIndex &&
+                memcmp(&last->Scissor, &draw.Scissor, sizeof(VkRect2D)) == 0) {
+                last->ElemCount += draw.ElemCount;
+                continue;
             }
+            g_Draws.push_back(draw);
         }
-        global_idx_offset += cmd_list->IdxBuffer.Size;
-        global_vtx_offset += cmd_list->VtxBuffer.Size;
+    }
+
+    // Setup desired Vulkan state
+    ImGui_ImplVulkan_SetupRenderState(draw_data, command_buffer, fb_width, fb_height);
+
+    // Render the draws, only recording the state that changed since the previous one
+    int bound_source = -1; // Direct, copied or -1 when nothing is bound
+    VkDescriptorSet bound_set = VK_NULL_HANDLE;
+    VkRect2D bound_scissor = {};
+    bool scissor_set = false;
+    ImTextureID bound_texture = NULL; // Bindless only, NULL is never a texture
+    for (int n = 0; n < g_Draws.Size; n++) {
+        const ImGui_ImplVulkanH_Draw* draw = &g_Draws[n];
+        if (draw->Callback != NULL) {
+            // User callback, registered via ImDrawList::AddCallback()
+            // (ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.)
+            if (draw->Callback->UserCallback == ImDrawCallback_ResetRenderState)
+                ImGui_ImplVulkan_SetupRenderState(draw_data, command_buffer, fb_width, fb_height);
+            else
+                draw->Callback->UserCallback(draw->CmdList, draw->Callback);
+
+            // Either may have changed any state
+            bound_source = -1;
+            bound_set = VK_NULL_HANDLE;
+            scissor_set = false;
+            bound_texture = NULL;
+            continue;
+        }
+
+        // Apply scissor/clipping rectangle
+        if (!scissor_set || memcmp(&bound_scissor, &draw->Scissor, sizeof(VkRect2D)) != 0) {
+            vkCmdSetScissor(command_buffer, 0, 1, &draw->Scissor);
+            bound_scissor = draw->Scissor;
+            scissor_set = true;
+            stats->ScissorSets++;
+        }
+
+        // Bind descriptorset with font or user texture, or the bindless set once and push the texture's index into it
+        VkDescriptorSet desc_set = (g_BindlessSet != VK_NULL_HANDLE) ? g_BindlessSet : (VkDescriptorSet)draw->TextureId;
+        if (bound_set != desc_set) {
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g_PipelineLayout, 0, 1, &desc_set, 0, NULL);
+            bound_set = desc_set;
+            stats->DescriptorBinds++;
+        }
+        if (g_BindlessSet != VK_NULL_HANDLE && bound_texture != draw->TextureId) {
+            uint32_t texture_index = (uint32_t)(intptr_t)draw->TextureId;
+            vkCmdPushConstants(command_buffer, g_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(float) * 4, sizeof(uint32_t), &texture_index);
+            bound_texture = draw->TextureId;
+            stats->TextureIndexPushes++;
+        }
+
+        // Bind the list's vertex/index buffer
+        if (bound_source != (int)draw->Direct) {
+            ImGui_ImplVulkan_BindGeometry(command_buffer, draw->Direct, vertex_offset, index_offset);
+            bound_source = (int)draw->Direct;
+        }
+
+        // Draw
+        vkCmdDrawIndexed(command_buffer, draw->ElemCount, 1, draw->FirstIndex, draw->VertexOffset, 0);
+        stats->DrawCalls++;
     }
 }
 
@@ -579,8 +943,8 @@ bool ImGui_ImplVulkan_CreateDeviceObjects()
         check_vk_result(err);
         VkShaderModuleCreateInfo frag_info = {};
         frag_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        frag_info.codeSize = sizeof(__glsl_shader_frag_spv);
-        frag_info.pCode = (uint32_t*)__glsl_shader_frag_spv;
+        frag_info.codeSize = v->BindlessTextureCount ? sizeof(__glsl_shader_bindless_frag_spv) : sizeof(__glsl_shader_frag_spv);
+        frag_info.pCode = v->BindlessTextureCount ? (uint32_t*)__glsl_shader_bindless_frag_spv : (uint32_t*)__glsl_shader_frag_spv;
         err = vkCreateShaderModule(v->Device, &frag_info, v->Allocator, &frag_module);
         check_vk_result(err);
     }
@@ -605,28 +969,63 @@ bool ImGui_ImplVulkan_CreateDeviceObjects()
         VkSampler sampler[1] = {g_FontSampler};
         VkDescriptorSetLayoutBinding binding[1] = {};
         binding[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        binding[0].descriptorCount = 1;
+        binding[0].descriptorCount = v->BindlessTextureCount ? v->BindlessTextureCount : 1;
         binding[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        // Bindless: slots are written while frames using other slots are pending, and removed ones are never cleared
+        VkDescriptorBindingFlagsEXT binding_flags[1] = {VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT};
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info = {};
+        flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        flags_info.bindingCount = 1;
+        flags_info.pBindingFlags = binding_flags;
         VkDescriptorSetLayoutCreateInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         info.bindingCount = 1;
         info.pBindings = binding;
+        if (v->BindlessTextureCount) {
+            info.pNext = &flags_info;
+            info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        }
         err = vkCreateDescriptorSetLayout(v->Device, &info, v->Allocator, &g_DescriptorSetLayout);
         check_vk_result(err);
     }
 
+    // The set holding every bindless texture, from a pool of its own as update-after-bind sets need a pool created for them
+    if (v->BindlessTextureCount && !g_BindlessPool) {
+        VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, v->BindlessTextureCount};
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+        pool_info.maxSets = 1;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+        err = vkCreateDescriptorPool(v->Device, &pool_info, v->Allocator, &g_BindlessPool);
+        check_vk_result(err);
+
+        VkDescriptorSetAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = g_BindlessPool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &g_DescriptorSetLayout;
+        err = vkAllocateDescriptorSets(v->Device, &alloc_info, &g_BindlessSet);
+        check_vk_result(err);
+    }
+
     if (!g_PipelineLayout) {
         // Constants: we are using 'vec2 offset' and 'vec2 scale' instead of a full 3d projection matrix
-        VkPushConstantRange push_constants[1] = {};
+        // (Bindless adds the texture index for the fragment shader)
+        VkPushConstantRange push_constants[2] = {};
         push_constants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         push_constants[0].offset = sizeof(float) * 0;
         push_constants[0].size = sizeof(float) * 4;
+        push_constants[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        push_constants[1].offset = sizeof(float) * 4;
+        push_constants[1].size = sizeof(uint32_t);
         VkDescriptorSetLayout set_layout[1] = {g_DescriptorSetLayout};
         VkPipelineLayoutCreateInfo layout_info = {};
         layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         layout_info.setLayoutCount = 1;
         layout_info.pSetLayouts = set_layout;
-        layout_info.pushConstantRangeCount = 1;
+        layout_info.pushConstantRangeCount = v->BindlessTextureCount ? 2 : 1;
         layout_info.pPushConstantRanges = push_constants;
         err = vkCreatePipelineLayout(v->Device, &layout_info, v->Allocator, &g_PipelineLayout);
         check_vk_result(err);
@@ -642,6 +1041,12 @@ bool ImGui_ImplVulkan_CreateDeviceObjects()
     stage[1].module = frag_module;
     stage[1].pName = "main";
 
+    // Sizes the bindless shader's texture array
+    VkSpecializationMapEntry texture_count_entry = {0, 0, sizeof(uint32_t)};
+    VkSpecializationInfo texture_count_info = {1, &texture_count_entry, sizeof(uint32_t), &v->BindlessTextureCount};
+    if (v->BindlessTextureCount)
+        stage[1].pSpecializationInfo = &texture_count_info;
+
     VkVertexInputBindingDescription binding_desc[1] = {};
     binding_desc[0].stride = sizeof(ImDrawVert);
     binding_desc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
@@ -754,7 +1159,7 @@ void ImGui_ImplVulkan_DestroyFontUploadObjects()
 void ImGui_ImplVulkan_DestroyDeviceObjects()
 {
     ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
-    ImGui_ImplVulkanH_DestroyWindowRenderBuffers(v->Device, &g_MainWindowRenderBuffers, v->Allocator);
+    ImGui_ImplVulkanH_DestroyStreamRings(v->Device, v->Allocator);
     ImGui_ImplVulkan_DestroyFontUploadObjects();
 
     if (g_FontView) {
@@ -773,6 +1178,13 @@ void ImGui_ImplVulkan_DestroyDeviceObjects()
         vkDestroySampler(v->Device, g_FontSampler, v->Allocator);
         g_FontSampler = VK_NULL_HANDLE;
     }
+    if (g_BindlessPool) {
+        vkDestroyDescriptorPool(v->Device, g_BindlessPool, v->Allocator);
+        g_BindlessPool = VK_NULL_HANDLE;
+        g_BindlessSet = VK_NULL_HANDLE;
+        g_BindlessNextSlot = 1;
+        g_BindlessFreeSlots.clear();
+    }
     if (g_DescriptorSetLayout) {
         vkDestroyDescriptorSetLayout(v->Device, g_DescriptorSetLayout, v->Allocator);
         g_DescriptorSetLayout = VK_NULL_HANDLE;
@@ -806,6 +1218,8 @@ bool ImGui_ImplVulkan_Init(ImGui_ImplVulkan_InitInfo* info, VkRenderPass render_
     g_VulkanInitInfo = *info;
     g_RenderPass = render_pass;
     ImGui_ImplVulkan_CreateDeviceObjects();
+    if (info->DirectGeometrySize > 0)
+        CreateDirectGeometry();
 
     return true;
 }
@@ -813,10 +1227,23 @@ bool ImGui_ImplVulkan_Init(ImGui_ImplVulkan_InitInfo* info, VkRenderPass render_
 void ImGui_ImplVulkan_Shutdown()
 {
     ImGui_ImplVulkan_DestroyDeviceObjects();
+    ImGui_ImplVulkanH_DestroyDirectGeometry(g_VulkanInitInfo.Device, g_VulkanInitInfo.Allocator);
+}
+
+bool ImGui_ImplVulkan_HasDirectGeometry()
+{
+    return g_DirectGeometry.Buffer != VK_NULL_HANDLE;
+}
+
+ImGui_ImplVulkan_RenderStats ImGui_ImplVulkan_GetRenderStats()
+{
+    return g_RenderStats;
 }
 
 void ImGui_ImplVulkan_NewFrame()
 {
+    if (g_DirectGeometry.Buffer != VK_NULL_HANDLE)
+        ImGui_ImplVulkan_NewDirectGeometryFrame();
 }
 
 void ImGui_ImplVulkan_SetMinImageCount(uint32_t min_image_count)
@@ -828,7 +1255,7 @@ void ImGui_ImplVulkan_SetMinImageCount(uint32_t min_image_count)
     ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
     VkResult err = vkDeviceWaitIdle(v->Device);
     check_vk_result(err);
-    ImGui_ImplVulkanH_DestroyWindowRenderBuffers(v->Device, &g_MainWindowRenderBuffers, v->Allocator);
+    ImGui_ImplVulkanH_DestroyStreamRings(v->Device, v->Allocator);
     g_VulkanInitInfo.MinImageCount = min_image_count;
 }
 
@@ -1174,36 +1601,31 @@ void ImGui_ImplVulkanH_DestroyFrameSemaphores(VkDevice device, ImGui_ImplVulkanH
     fsd->ImageAcquiredSemaphore = fsd->RenderCompleteSemaphore = VK_NULL_HANDLE;
 }
 
-void ImGui_ImplVulkanH_DestroyFrameRenderBuffers(VkDevice device, ImGui_ImplVulkanH_FrameRenderBuffers* buffers, const VkAllocationCallbacks* allocator)
+void ImGui_ImplVulkanH_DestroyStreamRings(VkDevice device, const VkAllocationCallbacks* allocator)
 {
-    if (buffers->VertexBuffer) {
-        vkDestroyBuffer(device, buffers->VertexBuffer, allocator);
-        buffers->VertexBuffer = VK_NULL_HANDLE;
+    for (int n = 0; n < g_RetiredStreamRings.Size; n++) {
+        vkDestroyBuffer(device, g_RetiredStreamRings[n].Buffer, allocator);
+        vkFreeMemory(device, g_RetiredStreamRings[n].Memory, allocator);
     }
-    if (buffers->VertexBufferMemory) {
-        vkFreeMemory(device, buffers->VertexBufferMemory, allocator);
-        buffers->VertexBufferMemory = VK_NULL_HANDLE;
-    }
-    if (buffers->IndexBuffer) {
-        vkDestroyBuffer(device, buffers->IndexBuffer, allocator);
-        buffers->IndexBuffer = VK_NULL_HANDLE;
-    }
-    if (buffers->IndexBufferMemory) {
-        vkFreeMemory(device, buffers->IndexBufferMemory, allocator);
-        buffers->IndexBufferMemory = VK_NULL_HANDLE;
-    }
-    buffers->VertexBufferSize = 0;
-    buffers->IndexBufferSize = 0;
+    g_RetiredStreamRings.clear();
+
+    if (g_StreamRing.Buffer)
+        vkDestroyBuffer(device, g_StreamRing.Buffer, allocator);
+    if (g_StreamRing.Memory)
+        vkFreeMemory(device, g_StreamRing.Memory, allocator);
+    memset(&g_StreamRing, 0, sizeof(g_StreamRing));
 }
 
-void ImGui_ImplVulkanH_DestroyWindowRenderBuffers(VkDevice device, ImGui_ImplVulkanH_WindowRenderBuffers* buffers, const VkAllocationCallbacks* allocator)
+// Draw lists may still point into the mapping, ImGui_ImplVulkan_MemFree() keeps ignoring that address range
+void ImGui_ImplVulkanH_DestroyDirectGeometry(VkDevice device, const VkAllocationCallbacks* allocator)
 {
-    for (uint32_t n = 0; n < buffers->Count; n++)
-        ImGui_ImplVulkanH_DestroyFrameRenderBuffers(device, &buffers->FrameRenderBuffers[n], allocator);
-    IM_FREE(buffers->FrameRenderBuffers);
-    buffers->FrameRenderBuffers = NULL;
-    buffers->Index = 0;
-    buffers->Count = 0;
+    ImGui_ImplVulkanH_DirectGeometry* dg = &g_DirectGeometry;
+    if (dg->Buffer)
+        vkDestroyBuffer(device, dg->Buffer, allocator);
+    if (dg->Memory)
+        vkFreeMemory(device, dg->Memory, allocator);
+    dg->Buffer = VK_NULL_HANDLE;
+    dg->Memory = VK_NULL_HANDLE;
 }
 
 ImTextureID ImGui_ImplVulkan_AddTexture(VkSampler sampler, VkImageView image_view, VkImageLayout image_layout)
@@ -1212,8 +1634,20 @@ ImTextureID ImGui_ImplVulkan_AddTexture(VkSampler sampler, VkImageView image_vie
 
     ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
     VkDescriptorSet descriptor_set;
-    // Create Descriptor Set:
-    {
+    uint32_t slot = 0;
+    // Take a slot of the bindless set, or create a Descriptor Set:
+    if (g_BindlessSet != VK_NULL_HANDLE) {
+        descriptor_set = g_BindlessSet;
+        if (g_BindlessFreeSlots.Size > 0) {
+            slot = g_BindlessFreeSlots.back();
+            g_BindlessFreeSlots.pop_back();
+        }
+        else {
+            IM_ASSERT(g_BindlessNextSlot < v->BindlessTextureCount && "Out of bindless texture slots, raise BindlessTextureCount");
+            slot = g_BindlessNextSlot++;
+        }
+    }
+    else {
         VkDescriptorSetAllocateInfo alloc_info = {};
         alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         alloc_info.descriptorPool = v->DescriptorPool;
@@ -1232,11 +1666,27 @@ ImTextureID ImGui_ImplVulkan_AddTexture(VkSampler sampler, VkImageView image_vie
         VkWriteDescriptorSet write_desc[1] = {};
         write_desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         write_desc[0].dstSet = descriptor_set;
+        write_desc[0].dstArrayElement = slot;
         write_desc[0].descriptorCount = 1;
         write_desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         write_desc[0].pImageInfo = desc_image;
         vkUpdateDescriptorSets(v->Device, 1, write_desc, 0, NULL);
     }
 
+    if (g_BindlessSet != VK_NULL_HANDLE)
+        return (ImTextureID)(intptr_t)slot;
     return (ImTextureID)descriptor_set;
-}
\ No newline at end of file
+}
+
+void ImGui_ImplVulkan_RemoveTexture(ImTextureID texture_id)
+{
+    ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
+    // The slot is only reused, partially bound arrays may hold stale descriptors no draw reads
+    if (g_BindlessSet != VK_NULL_HANDLE) {
+        g_BindlessFreeSlots.push_back((uint32_t)(intptr_t)texture_id);
+        return;
+    }
+    VkDescriptorSet descriptor_set = (VkDescriptorSet)texture_id;
+    VkResult err = vkFreeDescriptorSets(v->Device, v->DescriptorPool, 1, &descriptor_set);
+    check_vk_result(err);
+}
@@ -39,6 +39,25 @@ struct ImGui_ImplVulkan_InitInfo {
     VkSampleCountFlagBits MSAASamples; // >= VK_SAMPLE_COUNT_1_BIT
     const VkAllocationCallbacks* Allocator;
     void (*CheckVkResultFn)(VkResult err);
+    // Opt-in: bytes per in-flight frame of device-local, host-visible memory (e.g. ReBAR) that draw lists write their
+    // vertices and indices into directly, 0 to copy them at render time. Replaces ImGui's allocator functions, needs
+    // ImGui_ImplVulkan_NewFrame() before ImGui::NewFrame() and the draw data of that frame passed to RenderDrawData.
+    VkDeviceSize DirectGeometrySize;
+    // Opt-in: slots of one update-after-bind array of combined image samplers holding every texture, ImTextureID then is
+    // a slot index pushed per draw and the frame binds a single descriptor set, 0 for a descriptor set per texture. Needs
+    // VK_EXT_descriptor_indexing with descriptorBindingSampledImageUpdateAfterBind, descriptorBindingUpdateUnusedWhilePending,
+    // descriptorBindingPartiallyBound and shaderSampledImageArrayDynamicIndexing enabled.
+    uint32_t BindlessTextureCount;
+};
+
+// Counts of the last ImGui_ImplVulkan_RenderDrawData(), which used to record one draw, descriptor set bind and scissor
+// per visible command, so Commands minus each count is what merging and skipping unchanged state saved
+struct ImGui_ImplVulkan_RenderStats {
+    int Commands; // Visible ImDrawCmd, callbacks excluded
+    int DrawCalls;
+    int DescriptorBinds;
+    int ScissorSets;
+    int TextureIndexPushes; // Bindless only, texture changes once the single set is bound
 };
 
 // Called by user code
@@ -50,6 +69,9 @@ IMGUI_IMPL_API bool ImGui_ImplVulkan_CreateFontsTexture(VkCommandBuffer command_
 IMGUI_IMPL_API void ImGui_ImplVulkan_DestroyFontUploadObjects();
 IMGUI_IMPL_API void ImGui_ImplVulkan_SetMinImageCount(uint32_t min_image_count); // To override MinImageCount after initialization (e.g. if swap chain is recreated)
 IMGUI_IMPL_API ImTextureID ImGui_ImplVulkan_AddTexture(VkSampler sampler, VkImageView image_view, VkImageLayout image_layout);
+IMGUI_IMPL_API void ImGui_ImplVulkan_RemoveTexture(ImTextureID texture_id); // Descriptor pool must allow VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, texture must no longer be in use
+IMGUI_IMPL_API bool ImGui_ImplVulkan_HasDirectGeometry();                     // Whether DirectGeometrySize was requested and the device has suitable memory
+IMGUI_IMPL_API ImGui_ImplVulkan_RenderStats ImGui_ImplVulkan_GetRenderStats(); // Read on the thread calling RenderDrawData
 
 //-------------------------------------------------------------------------
 // Internal / Miscellaneous Vulkan Helpers
@@ -3,17 +3,60 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main()
+int main(int argc, char** argv)
 {
-    VulkanApp app(1024, 768, "Vulkan", true);
+    bool pipelined = false;
+    bool headless = false;
+    bool validation = true;
+    bool directGeometry = false;
+    bool bindlessTextures = false;
+    uint32_t frameCount = 0;
 
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pipelined") == 0) {
+            pipelined = true;
+        }
+        else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--no-validation") == 0) {
+            validation = false;
+        }
+        else if (strcmp(argv[i], "--direct-geometry") == 0) {
+            directGeometry = true;
+        }
+        else if (strcmp(argv[i], "--bindless-textures") == 0) {
+            bindlessTextures = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    // without a window nothing can close the app, run a fixed number of frames
+    if (headless && frameCount == 0) {
+        frameCount = 300;
+    }
+
+    VulkanApp app(1024, 768, "Vulkan", validation, headless);
+
+    // pipelined runs copy the draw lists into snapshots, direct geometry can't be used there
+    if (pipelined && directGeometry) {
+        std::cout << "--direct-geometry is ignored with --pipelined" << std::endl;
+        directGeometry = false;
+    }
+
+    app.setDirectImguiGeometry(directGeometry);
+    app.setBindlessImguiTextures(bindlessTextures);
     app.prepare();
 
     try {
-        app.run();
+        app.run(pipelined, frameCount);
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -0,0 +1,201 @@
+#include "CommandRecorder.h"
+#include "CpuProfiler.h"
+
+#include <stdexcept>
+#include <string>
+
+void CommandRecorder::init(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t frameCount)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+
+    this->device = device;
+    stopping = false;
+
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    pools.resize(threadCount);
+
+    for (auto& threadPools : pools) {
+        threadPools.resize(frameCount);
+
+        for (auto& pool : threadPools) {
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording command pool!");
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&CommandRecorder::workerLoop, this, i);
+    }
+}
+
+void CommandRecorder::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    workers.clear();
+
+    // destroying a pool frees its buffers
+    for (auto& threadPools : pools) {
+        for (auto& pool : threadPools) {
+            vkDestroyCommandPool(device, pool.commandPool, nullptr);
+        }
+    }
+
+    pools.clear();
+}
+
+void CommandRecorder::beginFrame(uint32_t frameIndex)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (pendingJobs != 0) {
+        throw std::runtime_error("recording jobs still pending at frame start!");
+    }
+
+    for (auto& threadPools : pools) {
+        FramePool& pool = threadPools[frameIndex];
+
+        if (pool.used != 0) {
+            vkResetCommandPool(device, pool.commandPool, 0);
+            pool.used = 0;
+        }
+    }
+
+    this->frameIndex = frameIndex;
+}
+
+size_t CommandRecorder::record(const VkCommandBufferInheritanceInfo& inheritance, std::function<void(VkCommandBuffer)> job)
+{
+    size_t index = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        index = results.size();
+        results.push_back(VK_NULL_HANDLE);
+        jobs.push_back(Job{inheritance, std::move(job), index});
+        pendingJobs++;
+    }
+
+    jobAvailable.notify_one();
+
+    return index;
+}
+
+std::vector<VkCommandBuffer> CommandRecorder::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<VkCommandBuffer> buffers;
+
+    jobsDone.wait(lock, [this] { return pendingJobs == 0; });
+
+    buffers.swap(results);
+
+    if (error) {
+        std::exception_ptr jobError = error;
+
+        error = nullptr;
+        std::rethrow_exception(jobError);
+    }
+
+    return buffers;
+}
+
+VkCommandBuffer CommandRecorder::acquireBuffer(FramePool& pool)
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+
+    if (pool.used == pool.buffers.size()) {
+        pool.buffers.push_back(VK_NULL_HANDLE);
+
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &pool.buffers.back()) != VK_SUCCESS) {
+            pool.buffers.pop_back();
+            throw std::runtime_error("failed to allocate secondary command buffer!");
+        }
+    }
+
+    return pool.buffers[pool.used++];
+}
+
+void CommandRecorder::workerLoop(uint32_t threadIndex)
+{
+    CpuProfiler::setThreadName("recorder " + std::to_string(threadIndex));
+
+    for (;;) {
+        Job job{};
+        FramePool* pool = nullptr;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::exception_ptr jobError;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (jobs.empty()) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            pool = &pools[threadIndex][frameIndex];
+        }
+
+        try {
+            CpuZone zone("record secondary buffer");
+            VkCommandBufferBeginInfo beginInfo{};
+
+            commandBuffer = acquireBuffer(*pool);
+
+            job.inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &job.inheritance;
+
+            if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+                throw std::runtime_error("failed to begin recording secondary command buffer!");
+            }
+
+            job.record(commandBuffer);
+
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer!");
+            }
+        }
+        catch (...) {
+            jobError = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            results[job.index] = commandBuffer;
+
+            if (jobError && !error) {
+                error = jobError;
+            }
+
+            if (--pendingJobs == 0) {
+                jobsDone.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef _COMMAND_RECORDER_H_
+#define _COMMAND_RECORDER_H_
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records secondary command buffers on a pool of worker threads. Every worker
+// owns one command pool per frame in flight, so recording never contends on a
+// pool and a whole frame of buffers is recycled with a single pool reset.
+class CommandRecorder {
+public:
+    void init(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t frameCount);
+    void cleanup();
+    // recycles the buffers of frameIndex, its previous submission must have completed
+    void beginFrame(uint32_t frameIndex);
+    // queues a job recording into a secondary buffer continuing the render pass of
+    // inheritance, returns the position of that buffer in the result of wait()
+    size_t record(const VkCommandBufferInheritanceInfo& inheritance, std::function<void(VkCommandBuffer)> job);
+    // waits for every job queued since the last wait, buffers are in record() order
+    std::vector<VkCommandBuffer> wait();
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+    struct Job {
+        VkCommandBufferInheritanceInfo inheritance;
+        std::function<void(VkCommandBuffer)> record;
+        size_t index;
+    };
+
+    struct FramePool {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        size_t used = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    std::vector<std::thread> workers;
+    std::vector<std::vector<FramePool>> pools; // [thread][frame]
+    uint32_t frameIndex = 0;
+    std::deque<Job> jobs;
+    std::vector<VkCommandBuffer> results;
+    size_t pendingJobs = 0;
+    std::exception_ptr error;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsDone;
+
+    void workerLoop(uint32_t threadIndex);
+    VkCommandBuffer acquireBuffer(FramePool& pool);
+};
+
+#endif
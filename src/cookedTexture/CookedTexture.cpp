@@ -0,0 +1,110 @@
+#include "CookedTexture.h"
+#include "MipChain.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t cookedLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    uint64_t blocks = static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4);
+
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return static_cast<uint64_t>(width) * height * 4;
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        return blocks * 8;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return blocks * 16;
+    default:
+        return 0;
+    }
+}
+
+CookedTextureFile::~CookedTextureFile()
+{
+    if (mapping != nullptr) {
+        munmap(const_cast<uint8_t*>(mapping), size);
+    }
+}
+
+void CookedTextureFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info {};
+    void* address = MAP_FAILED;
+
+    if (fd < 0) {
+        throw std::runtime_error("failed to open cooked texture " + path + "!");
+    }
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    // the mapping keeps the file alive
+    close(fd);
+
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("failed to map cooked texture " + path + "!");
+    }
+
+    mapping = static_cast<const uint8_t*>(address);
+    size = static_cast<size_t>(info.st_size);
+
+    // start reading ahead, the pages are touched next by the staging copy
+    madvise(address, size, MADV_WILLNEED);
+
+    validate(path);
+}
+
+void CookedTextureFile::validate(const std::string& path)
+{
+    bool valid = size >= sizeof(CookedTextureHeader);
+
+    if (valid) {
+        header = reinterpret_cast<const CookedTextureHeader*>(mapping);
+        payloads = reinterpret_cast<const CookedPayload*>(mapping + sizeof(CookedTextureHeader));
+
+        valid = header->magic == COOKED_TEXTURE_MAGIC &&
+                header->version == COOKED_TEXTURE_VERSION &&
+                header->width > 0 && header->height > 0 &&
+                header->mipLevels > 0 && header->mipLevels <= COOKED_MAX_MIP_LEVELS &&
+                header->mipLevels <= mipLevelCount(header->width, header->height) &&
+                header->payloadCount > 0 && header->payloadCount <= COOKED_MAX_PAYLOADS &&
+                size >= sizeof(CookedTextureHeader) + header->payloadCount * sizeof(CookedPayload);
+    }
+
+    for (uint32_t i = 0; valid && i < header->payloadCount; i++) {
+        const CookedPayload& payload = payloads[i];
+        uint64_t next = payload.levels[0].offset;
+
+        // levels are contiguous so a payload is staged with a single copy
+        for (uint32_t level = 0; valid && level < header->mipLevels; level++) {
+            uint32_t width = std::max(header->width >> level, 1u);
+            uint32_t height = std::max(header->height >> level, 1u);
+            const CookedLevel& cooked = payload.levels[level];
+
+            // written so neither side can wrap for offsets near the top of the range
+            valid = cooked.offset == next &&
+                    cooked.offset % COOKED_DATA_ALIGNMENT == 0 &&
+                    cooked.size == cookedLevelSize(static_cast<VkFormat>(payload.format), width, height) &&
+                    cooked.size > 0 &&
+                    cooked.offset <= size && cooked.size <= size - cooked.offset;
+
+            // the level ends inside the mapping, so this doesn't wrap either
+            if (valid) {
+                next = (cooked.offset + cooked.size + COOKED_DATA_ALIGNMENT - 1) / COOKED_DATA_ALIGNMENT * COOKED_DATA_ALIGNMENT;
+            }
+        }
+    }
+
+    if (!valid) {
+        throw std::runtime_error("invalid cooked texture " + path + "!");
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef _COOKED_TEXTURE_H_
+#define _COOKED_TEXTURE_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// "CTEX", little endian
+constexpr uint32_t COOKED_TEXTURE_MAGIC = 0x58455443;
+constexpr uint32_t COOKED_TEXTURE_VERSION = 1;
+constexpr uint32_t COOKED_MAX_MIP_LEVELS = 16;
+constexpr uint32_t COOKED_MAX_PAYLOADS = 4;
+// level data starts at multiples of this, a multiple of every block size
+constexpr uint64_t COOKED_DATA_ALIGNMENT = 16;
+const std::string COOKED_TEXTURE_EXTENSION = ".ctex";
+
+// File layout: the header, payloadCount payloads, then level data. Every payload holds the
+// same mip chain in another format, preferred first, its levels stored one after another.
+struct CookedTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t mipLevels;
+    uint32_t payloadCount;
+};
+
+struct CookedLevel {
+    uint64_t offset; // from the start of the file
+    uint64_t size;
+};
+
+struct CookedPayload {
+    uint32_t format; // VkFormat
+    uint32_t reserved;
+    CookedLevel levels[COOKED_MAX_MIP_LEVELS];
+};
+
+// bytes of a width x height level, rounded up to whole blocks, 0 for formats that can't be cooked
+uint64_t cookedLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+// A cooked texture mapped read only, level data is read straight from the mapping
+class CookedTextureFile {
+public:
+    CookedTextureFile() = default;
+    CookedTextureFile(const CookedTextureFile&) = delete;
+    CookedTextureFile& operator=(const CookedTextureFile&) = delete;
+    ~CookedTextureFile();
+    // throws if the file can't be mapped or is not a valid cooked texture
+    void open(const std::string& path);
+    const CookedTextureHeader& getHeader() const { return *header; }
+    const CookedPayload& getPayload(uint32_t index) const { return payloads[index]; }
+    const uint8_t* getData(uint64_t offset) const { return mapping + offset; }
+
+private:
+    const uint8_t* mapping = nullptr;
+    size_t size = 0;
+    const CookedTextureHeader* header = nullptr;
+    const CookedPayload* payloads = nullptr;
+
+    void validate(const std::string& path);
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+std::atomic<bool> CpuProfiler::recording{false};
+std::mutex CpuProfiler::mutex;
+std::vector<std::unique_ptr<CpuProfiler::ThreadBuffer>> CpuProfiler::buffers;
+uint32_t CpuProfiler::requestedFrames = 0;
+uint32_t CpuProfiler::remainingFrames = 0;
+std::string CpuProfiler::capturePath;
+std::string CpuProfiler::lastTrace;
+
+uint64_t CpuProfiler::now()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+
+    // never 0, CpuZone uses 0 for "not recording"
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count() + 1;
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::getThreadBuffer()
+{
+    static thread_local ThreadBuffer* buffer = nullptr;
+
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        buffers.emplace_back(new ThreadBuffer{});
+        buffer = buffers.back().get();
+        buffer->id = static_cast<uint32_t>(buffers.size());
+        buffer->name = "thread " + std::to_string(buffer->id);
+        buffer->zones.reset(new Zone[CPU_PROFILER_THREAD_ZONES]);
+    }
+
+    return buffer;
+}
+
+void CpuProfiler::setThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    buffer->name = name;
+}
+
+void CpuProfiler::addZone(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    uint64_t index = buffer->count.load(std::memory_order_relaxed);
+
+    buffer->zones[index % CPU_PROFILER_THREAD_ZONES] = Zone{name, start, end};
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::requestCapture(uint32_t frameCount, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (requestedFrames != 0 || remainingFrames != 0 || frameCount == 0) {
+        return;
+    }
+
+    requestedFrames = frameCount;
+    capturePath = path;
+}
+
+bool CpuProfiler::isCapturePending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return requestedFrames != 0 || remainingFrames != 0;
+}
+
+std::string CpuProfiler::getLastTrace()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return lastTrace;
+}
+
+void CpuProfiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (requestedFrames != 0) {
+        // start on a frame boundary so the first frame is complete
+        for (auto& buffer : buffers) {
+            buffer->captureStart = buffer->count.load(std::memory_order_acquire);
+        }
+
+        remainingFrames = requestedFrames;
+        requestedFrames = 0;
+        recording = true;
+    }
+    else if (remainingFrames != 0 && --remainingFrames == 0) {
+        recording = false;
+        writeTrace();
+    }
+}
+
+void CpuProfiler::writeTrace()
+{
+    std::ofstream file(capturePath, std::ios::trunc);
+    bool first = true;
+
+    if (!file.is_open()) {
+        std::cerr << "failed to open " << capturePath << " for the cpu trace!" << std::endl;
+        return;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    for (auto& buffer : buffers) {
+        uint64_t end = buffer->count.load(std::memory_order_acquire);
+        // zones still being written after recording stopped may reuse the oldest slots
+        uint64_t begin = std::max(buffer->captureStart, end > CPU_PROFILER_THREAD_ZONES / 2 ? end - CPU_PROFILER_THREAD_ZONES / 2 : 0);
+
+        file << (first ? "" : ",\n")
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+             << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+        first = false;
+
+        for (uint64_t i = begin; i < end; i++) {
+            const Zone& zone = buffer->zones[i % CPU_PROFILER_THREAD_ZONES];
+
+            file << ",\n{\"name\":\"" << zone.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                 << ",\"ts\":" << zone.start / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+        }
+    }
+
+    file << "\n]}\n";
+
+    lastTrace = capturePath;
+    std::cout << "cpu trace written to " << capturePath << std::endl;
+}
@@ -0,0 +1,79 @@
+#ifndef _CPU_PROFILER_H_
+#define _CPU_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// zones a thread can record during one capture
+constexpr uint32_t CPU_PROFILER_THREAD_ZONES = 32 * 1024;
+
+// Records named CPU zones of every thread while a capture is running and writes
+// the captured frames as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Each thread appends to its own buffer, so recording a zone takes no lock.
+class CpuProfiler {
+public:
+    // captures the next frameCount frames into path, ignored while a capture is running
+    static void requestCapture(uint32_t frameCount, const std::string& path);
+    // frame boundary, called once per frame by the thread driving the frames
+    static void endFrame();
+    static void setThreadName(const std::string& name);
+    static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+    static bool isCapturePending();
+    // path of the last written trace, empty if there is none
+    static std::string getLastTrace();
+    static uint64_t now();
+    static void addZone(const char* name, uint64_t start, uint64_t end);
+
+private:
+    struct Zone {
+        const char* name;
+        uint64_t start; // ns
+        uint64_t end;
+    };
+
+    struct ThreadBuffer {
+        std::string name;
+        uint32_t id;
+        std::unique_ptr<Zone[]> zones;
+        // zones ever written, the writer publishes a zone by incrementing it
+        std::atomic<uint64_t> count{0};
+        uint64_t captureStart = 0; // a buffer created mid-capture belongs to it from the start
+    };
+
+    static std::atomic<bool> recording;
+    static std::mutex mutex; // guards the buffer list and the capture state, never taken per zone
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    static uint32_t requestedFrames;
+    static uint32_t remainingFrames;
+    static std::string capturePath;
+    static std::string lastTrace;
+
+    static ThreadBuffer* getThreadBuffer();
+    static void writeTrace();
+};
+
+// Records the lifetime of the object as a zone of the current thread
+class CpuZone {
+public:
+    explicit CpuZone(const char* name) :
+        name(name), start(CpuProfiler::isRecording() ? CpuProfiler::now() : 0) {}
+    ~CpuZone()
+    {
+        if (start != 0) {
+            CpuProfiler::addZone(name, start, CpuProfiler::now());
+        }
+    }
+
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "DeletionQueue.h"
+
+#include <algorithm>
+
+void DeletionQueue::push(std::function<void()> destroy)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    nextFrame.push_back(std::move(destroy));
+}
+
+// called with the mutex held
+void DeletionQueue::insert(uint64_t value, std::function<void()> destroy)
+{
+    auto it = std::upper_bound(entries.begin(), entries.end(), value, [](uint64_t v, const Entry& entry) { return v < entry.value; });
+
+    entries.insert(it, Entry{value, std::move(destroy)});
+}
+
+void DeletionQueue::push(uint64_t value, std::function<void()> destroy)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    insert(value, std::move(destroy));
+}
+
+void DeletionQueue::stamp(uint64_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& destroy : nextFrame) {
+        insert(value, std::move(destroy));
+    }
+
+    nextFrame.clear();
+}
+
+void DeletionQueue::collect(uint64_t completedValue)
+{
+    std::vector<std::function<void()>> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        while (!entries.empty() && entries.front().value <= completedValue) {
+            ready.push_back(std::move(entries.front().destroy));
+            entries.pop_front();
+        }
+    }
+
+    // outside the lock, destroying may queue more
+    for (auto& destroy : ready) {
+        destroy();
+    }
+}
+
+void DeletionQueue::flush()
+{
+    std::vector<std::function<void()>> ready;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (entries.empty() && nextFrame.empty()) {
+            return;
+        }
+
+        for (auto& entry : entries) {
+            ready.push_back(std::move(entry.destroy));
+        }
+
+        for (auto& destroy : nextFrame) {
+            ready.push_back(std::move(destroy));
+        }
+
+        entries.clear();
+        nextFrame.clear();
+    }
+
+    for (auto& destroy : ready) {
+        destroy();
+    }
+
+    // for whatever destroying queued
+    flush();
+}
+
+size_t DeletionQueue::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return entries.size() + nextFrame.size();
+}
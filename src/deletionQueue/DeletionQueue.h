@@ -0,0 +1,42 @@
+#ifndef _DELETION_QUEUE_H_
+#define _DELETION_QUEUE_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Destroys resources once the GPU can no longer use them, without waiting for
+// the device to idle. An entry is keyed on the frame timeline value of the last
+// submission that may use the resource and runs once that value has completed.
+// Destroy callbacks should capture handles by value, they may outlive the object
+// that queued them until the final flush().
+class DeletionQueue {
+public:
+    // retires with the next frame submitted, for resources the frame being recorded may still use
+    void push(std::function<void()> destroy);
+    // retires with value, for resources last used by an already submitted frame
+    void push(uint64_t value, std::function<void()> destroy);
+    // keys every entry waiting for the next frame on value, called when the frame is submitted
+    void stamp(uint64_t value);
+    // runs every entry keyed on a completed value
+    void collect(uint64_t completedValue);
+    // runs everything, only once the device is idle
+    void flush();
+    size_t size();
+
+private:
+    struct Entry {
+        uint64_t value;
+        std::function<void()> destroy;
+    };
+
+    std::mutex mutex;
+    std::deque<Entry> entries; // sorted by value
+    std::vector<std::function<void()>> nextFrame;
+
+    void insert(uint64_t value, std::function<void()> destroy);
+};
+
+#endif
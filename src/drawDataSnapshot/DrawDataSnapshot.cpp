@@ -0,0 +1,47 @@
+#include "DrawDataSnapshot.h"
+
+#include <cstring>
+
+template <typename T>
+static void copyVector(ImVector<T>& dst, const ImVector<T>& src)
+{
+    // resize only grows the allocation, unlike ImVector's assignment operator
+    dst.resize(src.Size);
+
+    if (src.Size > 0) {
+        memcpy(dst.Data, src.Data, src.size_in_bytes());
+    }
+}
+
+DrawDataSnapshot::~DrawDataSnapshot()
+{
+    for (auto drawList : drawLists) {
+        IM_DELETE(drawList);
+    }
+}
+
+void DrawDataSnapshot::capture(const ImDrawData* source)
+{
+    while (drawLists.size() < static_cast<size_t>(source->CmdListsCount)) {
+        drawLists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+    }
+
+    for (int i = 0; i < source->CmdListsCount; i++) {
+        const ImDrawList* src = source->CmdLists[i];
+        ImDrawList* dst = drawLists[i];
+
+        copyVector(dst->CmdBuffer, src->CmdBuffer);
+        copyVector(dst->IdxBuffer, src->IdxBuffer);
+        copyVector(dst->VtxBuffer, src->VtxBuffer);
+        dst->Flags = src->Flags;
+    }
+
+    drawData.Valid = source->Valid;
+    drawData.CmdLists = drawLists.data();
+    drawData.CmdListsCount = source->CmdListsCount;
+    drawData.TotalIdxCount = source->TotalIdxCount;
+    drawData.TotalVtxCount = source->TotalVtxCount;
+    drawData.DisplayPos = source->DisplayPos;
+    drawData.DisplaySize = source->DisplaySize;
+    drawData.FramebufferScale = source->FramebufferScale;
+}
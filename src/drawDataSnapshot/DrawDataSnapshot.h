@@ -0,0 +1,24 @@
+#ifndef _DRAW_DATA_SNAPSHOT_H_
+#define _DRAW_DATA_SNAPSHOT_H_
+
+#include "imgui.h"
+
+#include <vector>
+
+// Deep copy of an ImDrawData, so one frame can be rendered while ImGui builds
+// the next one. The copied draw lists keep their storage between captures.
+class DrawDataSnapshot {
+public:
+    DrawDataSnapshot() = default;
+    DrawDataSnapshot(const DrawDataSnapshot&) = delete;
+    DrawDataSnapshot& operator=(const DrawDataSnapshot&) = delete;
+    ~DrawDataSnapshot();
+    void capture(const ImDrawData* source);
+    ImDrawData* get() { return &drawData; }
+
+private:
+    ImDrawData drawData;
+    std::vector<ImDrawList*> drawLists;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "FrameRingBuffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void FrameRingBuffer::init(void* mapped, VkDeviceSize frameSize, uint32_t frameCount, VkDeviceSize alignment)
+{
+    this->mapped = static_cast<char*>(mapped);
+    this->alignment = std::max<VkDeviceSize>(alignment, 1);
+    this->frameSize = alignUp(frameSize, this->alignment);
+    this->frameCount = frameCount;
+    frameBegin = 0;
+    head = 0;
+}
+
+void FrameRingBuffer::beginFrame(uint32_t frameIndex)
+{
+    frameBegin = frameSize * (frameIndex % frameCount);
+    head = frameBegin;
+}
+
+VkDeviceSize FrameRingBuffer::allocate(VkDeviceSize size, void** data)
+{
+    VkDeviceSize offset = alignUp(head, alignment);
+
+    if (offset + size > frameBegin + frameSize) {
+        throw std::runtime_error("frame ring buffer budget exceeded!");
+    }
+
+    head = offset + size;
+    *data = mapped + offset;
+
+    return offset;
+}
@@ -0,0 +1,27 @@
+#ifndef _FRAME_RING_BUFFER_H_
+#define _FRAME_RING_BUFFER_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// Linear allocator over persistently mapped memory split into one region per frame in flight.
+// A region is only rewritten once the frame that last used it has retired,
+// so callers only memcpy into it and bind the returned offset as a dynamic offset.
+class FrameRingBuffer {
+public:
+    void init(void* mapped, VkDeviceSize frameSize, uint32_t frameCount, VkDeviceSize alignment);
+    void beginFrame(uint32_t frameIndex);
+    VkDeviceSize allocate(VkDeviceSize size, void** data);
+    VkDeviceSize size() const { return frameSize * frameCount; }
+
+private:
+    char* mapped = nullptr;
+    VkDeviceSize frameSize = 0;
+    uint32_t frameCount = 0;
+    VkDeviceSize alignment = 1;
+    VkDeviceSize frameBegin = 0;
+    VkDeviceSize head = 0;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include "FrameTimeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void FrameTimeline::init(VkDevice device, bool useTimelineSemaphore)
+{
+    VkSemaphoreTypeCreateInfoKHR typeInfo{};
+    VkSemaphoreCreateInfo semaphoreInfo{};
+
+    this->device = device;
+
+    if (!useTimelineSemaphore) {
+        return;
+    }
+
+    waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+    getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+
+    if (waitSemaphores == nullptr || getSemaphoreCounterValue == nullptr) {
+        throw std::runtime_error("failed to load timeline semaphore functions!");
+    }
+
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue = 0;
+
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+void FrameTimeline::cleanup()
+{
+    wait(submittedValue());
+
+    for (VkFence fence : freeFences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+
+    freeFences.clear();
+
+    vkDestroySemaphore(device, semaphore, nullptr);
+    semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t FrameTimeline::reserve()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return nextValue++;
+}
+
+uint64_t FrameTimeline::submittedValue()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return lastSubmitted;
+}
+
+VkFence FrameTimeline::acquireFence()
+{
+    VkFenceCreateInfo fenceInfo{};
+    VkFence fence = VK_NULL_HANDLE;
+
+    if (!freeFences.empty()) {
+        fence = freeFences.back();
+        freeFences.pop_back();
+        vkResetFences(device, 1, &fence);
+
+        return fence;
+    }
+
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline fence!");
+    }
+
+    return fence;
+}
+
+void FrameTimeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo, uint64_t value, const uint64_t* pWaitValues)
+{
+    VkSubmitInfo info = submitInfo;
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+    std::vector<VkSemaphore> waitSemaphores(submitInfo.pWaitSemaphores, submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+    std::vector<VkPipelineStageFlags> waitStages(submitInfo.pWaitDstStageMask, submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+    std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    // binary semaphores ignore their value
+    std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+    std::vector<uint64_t> signalValues(submitInfo.signalSemaphoreCount, 0);
+    VkFence fence = VK_NULL_HANDLE;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (value <= lastSubmitted) {
+        throw std::runtime_error("timeline values must be submitted in reservation order!");
+    }
+
+    if (pWaitValues != nullptr) {
+        waitValues.assign(pWaitValues, pWaitValues + submitInfo.waitSemaphoreCount);
+    }
+
+    if (usesTimelineSemaphore()) {
+        // a value may only be signalled once everything below it has been, which
+        // another queue only guarantees when it waits for the previous submission
+        if (lastSubmitted != 0 && queue != lastQueue) {
+            waitSemaphores.push_back(semaphore);
+            waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            waitValues.push_back(lastSubmitted);
+        }
+
+        signalSemaphores.push_back(semaphore);
+        signalValues.push_back(value);
+
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.pNext = submitInfo.pNext;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        info.pNext = &timelineInfo;
+        info.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        info.pWaitSemaphores = waitSemaphores.data();
+        info.pWaitDstStageMask = waitStages.data();
+        info.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        info.pSignalSemaphores = signalSemaphores.data();
+    }
+    else {
+        fence = acquireFence();
+    }
+
+    if (vkQueueSubmit(queue, 1, &info, fence) != VK_SUCCESS) {
+        if (fence != VK_NULL_HANDLE) {
+            freeFences.push_back(fence);
+        }
+
+        throw std::runtime_error("failed to submit to the frame timeline!");
+    }
+
+    if (fence != VK_NULL_HANDLE) {
+        pendingFences.push_back({value, fence});
+    }
+
+    lastSubmitted = value;
+    lastQueue = queue;
+}
+
+// fallback only, called with the mutex held
+void FrameTimeline::retireFences()
+{
+    uint64_t value = completed.load(std::memory_order_relaxed);
+
+    // fences of different queues may signal out of order, only a completed prefix counts
+    while (!pendingFences.empty() && vkGetFenceStatus(device, pendingFences.front().fence) == VK_SUCCESS) {
+        value = pendingFences.front().value;
+        freeFences.push_back(pendingFences.front().fence);
+        pendingFences.pop_front();
+    }
+
+    // reserved values that were never submitted are complete once everything before them is
+    if (pendingFences.empty()) {
+        value = std::max(value, lastSubmitted);
+    }
+    else {
+        value = std::max(value, pendingFences.front().value - 1);
+    }
+
+    completed.store(value, std::memory_order_release);
+}
+
+uint64_t FrameTimeline::poll()
+{
+    uint64_t value = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (usesTimelineSemaphore()) {
+        if (getSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS) {
+            throw std::runtime_error("failed to read the timeline semaphore!");
+        }
+
+        completed.store(std::max(value, completed.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
+    else {
+        retireFences();
+    }
+
+    return completed.load(std::memory_order_relaxed);
+}
+
+bool FrameTimeline::isComplete(uint64_t value)
+{
+    if (value <= completedValue()) {
+        return true;
+    }
+
+    return value <= poll();
+}
+
+void FrameTimeline::wait(uint64_t value)
+{
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    VkFence fence = VK_NULL_HANDLE;
+
+    if (value > submittedValue()) {
+        throw std::runtime_error("waiting for a timeline value that was never submitted!");
+    }
+
+    while (!isComplete(value)) {
+        if (usesTimelineSemaphore()) {
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &semaphore;
+            waitInfo.pValues = &value;
+
+            if (waitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+                throw std::runtime_error("failed to wait for the timeline semaphore!");
+            }
+
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // another thread may have retired the rest in the meantime
+            if (pendingFences.empty()) {
+                continue;
+            }
+
+            fence = pendingFences.front().fence;
+        }
+
+        // waits outside the lock, the fence stays pending until retireFences sees it signalled
+        vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef _FRAME_TIMELINE_H_
+#define _FRAME_TIMELINE_H_
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// One monotonically increasing counter for a stream of queue submissions, e.g. the
+// frames or the upload batches, each stream has its own so neither queue waits on
+// the other. A submission signals the value it reserved, and once a value has
+// completed so has every value below it, so "has N retired" is a single comparison
+// against completedValue().
+// Backed by a VK_KHR_timeline_semaphore where supported, otherwise by a fence per
+// submission that is polled in value order.
+class FrameTimeline {
+public:
+    void init(VkDevice device, bool useTimelineSemaphore);
+    void cleanup();
+    // the value the caller's next submission signals, values must be submitted in reservation order
+    uint64_t reserve();
+    // submits one batch signalling value, on top of any semaphores in submitInfo, waitValues holds
+    // a value per wait semaphore of submitInfo for those that are timeline semaphores (0 for binary)
+    void submit(VkQueue queue, const VkSubmitInfo& submitInfo, uint64_t value, const uint64_t* waitValues = nullptr);
+    // refreshes completedValue() with one query, returns it
+    uint64_t poll();
+    // every value up to this one has completed, as of the last poll or wait
+    uint64_t completedValue() const { return completed.load(std::memory_order_acquire); }
+    bool isComplete(uint64_t value);
+    void wait(uint64_t value);
+    // last value handed to a queue, 0 if nothing was submitted yet
+    uint64_t submittedValue();
+    bool usesTimelineSemaphore() const { return semaphore != VK_NULL_HANDLE; }
+    // other queues wait on it for the values they consume, VK_NULL_HANDLE in fence mode
+    VkSemaphore getSemaphore() const { return semaphore; }
+
+private:
+    struct PendingFence {
+        uint64_t value;
+        VkFence fence;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+    std::mutex mutex; // guards everything below
+    uint64_t nextValue = 1;
+    uint64_t lastSubmitted = 0;
+    VkQueue lastQueue = VK_NULL_HANDLE;
+    std::atomic<uint64_t> completed{0};
+    // fallback, fences of submissions not known to be complete yet, in value order
+    std::deque<PendingFence> pendingFences;
+    std::vector<VkFence> freeFences;
+
+    VkFence acquireFence();
+    void retireFences();
+};
+
+#endif
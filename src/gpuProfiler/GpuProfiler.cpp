@@ -0,0 +1,155 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount)
+{
+    VkPhysicalDeviceProperties properties{};
+    VkQueryPoolCreateInfo poolInfo{};
+    uint32_t queueFamilyCount = 0;
+    uint32_t validBits = 0;
+
+    this->device = device;
+
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+
+    // the queue can't write timestamps, scopes become no-ops
+    if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+        return;
+    }
+
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    frames.resize(frameCount);
+
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frameCount * MAX_GPU_SCOPES * 2;
+
+    if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+}
+
+void GpuProfiler::cleanup()
+{
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex, VkCommandBuffer commandBuffer)
+{
+    if (!isSupported()) {
+        return;
+    }
+
+    if (frames[frameIndex].pending) {
+        collect(frameIndex);
+    }
+
+    frames[frameIndex].names.clear();
+    frames[frameIndex].pending = false;
+    this->frameIndex = frameIndex;
+
+    vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex * MAX_GPU_SCOPES * 2, MAX_GPU_SCOPES * 2);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+    uint32_t scope = 0;
+
+    if (!isSupported() || frames[frameIndex].names.size() == MAX_GPU_SCOPES) {
+        return UINT32_MAX;
+    }
+
+    FrameQueries& frame = frames[frameIndex];
+    scope = static_cast<uint32_t>(frame.names.size());
+
+    frame.names.push_back(name);
+    frame.pending = true;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, (frameIndex * MAX_GPU_SCOPES + scope) * 2);
+
+    return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+    if (scope == UINT32_MAX) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, (frameIndex * MAX_GPU_SCOPES + scope) * 2 + 1);
+}
+
+void GpuProfiler::collect(uint32_t frameIndex)
+{
+    FrameQueries& frame = frames[frameIndex];
+    uint32_t queryCount = static_cast<uint32_t>(frame.names.size()) * 2;
+    std::vector<uint64_t> timestamps(queryCount);
+
+    // the frame's fence has signalled, so the results are available without waiting
+    if (vkGetQueryPoolResults(device, queryPool, frameIndex * MAX_GPU_SCOPES * 2, queryCount,
+                              timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                              sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t i = 0; i < frame.names.size(); i++) {
+        uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask;
+
+        addSample(frame.names[i], static_cast<float>(static_cast<double>(ticks) * timestampPeriod / 1000000.0));
+    }
+}
+
+void GpuProfiler::addSample(const char* name, float milliseconds)
+{
+    auto it = std::find_if(history.begin(), history.end(), [name](const ScopeHistory& scope) {
+        return scope.stats.name == name;
+    });
+
+    if (it == history.end()) {
+        history.emplace_back();
+        it = std::prev(history.end());
+        it->stats.name = name;
+    }
+
+    it->samples[it->next] = milliseconds;
+    it->next = (it->next + 1) % GPU_PROFILER_HISTORY;
+    it->count = std::min(it->count + 1, GPU_PROFILER_HISTORY);
+
+    it->stats.last = milliseconds;
+    it->stats.min = it->samples[0];
+    it->stats.max = it->samples[0];
+    it->stats.avg = 0.0f;
+
+    for (uint32_t i = 0; i < it->count; i++) {
+        it->stats.min = std::min(it->stats.min, it->samples[i]);
+        it->stats.max = std::max(it->stats.max, it->samples[i]);
+        it->stats.avg += it->samples[i];
+    }
+
+    it->stats.avg /= it->count;
+}
+
+std::vector<GpuScopeStats> GpuProfiler::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<GpuScopeStats> stats;
+
+    for (auto& scope : history) {
+        stats.push_back(scope.stats);
+    }
+
+    return stats;
+}
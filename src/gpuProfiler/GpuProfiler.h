@@ -0,0 +1,66 @@
+#ifndef _GPU_PROFILER_H_
+#define _GPU_PROFILER_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// timestamp scopes a single frame can record
+constexpr uint32_t MAX_GPU_SCOPES = 32;
+// frames the rolling min/avg/max are computed over
+constexpr uint32_t GPU_PROFILER_HISTORY = 120;
+
+struct GpuScopeStats {
+    std::string name;
+    float last = 0.0f; // ms
+    float min = 0.0f;
+    float avg = 0.0f;
+    float max = 0.0f;
+};
+
+// Measures GPU time of command buffer scopes with timestamp queries. Every frame
+// in flight has its own range of queries, read back once the frame has retired,
+// so collecting results never waits on the GPU.
+class GpuProfiler {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount);
+    void cleanup();
+    // collects the results frameIndex recorded last time and resets its queries,
+    // must be recorded outside of a render pass before any scope of the frame
+    void beginFrame(uint32_t frameIndex, VkCommandBuffer commandBuffer);
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+    bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+    // safe to call from another thread than the recording one
+    std::vector<GpuScopeStats> getStats();
+
+private:
+    struct FrameQueries {
+        std::vector<const char*> names; // one per scope, recorded in order
+        bool pending = false;
+    };
+
+    struct ScopeHistory {
+        GpuScopeStats stats;
+        float samples[GPU_PROFILER_HISTORY];
+        uint32_t count = 0;
+        uint32_t next = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    float timestampPeriod = 1.0f; // ns per tick
+    uint64_t timestampMask = 0;
+    std::vector<FrameQueries> frames;
+    uint32_t frameIndex = 0;
+    std::vector<ScopeHistory> history;
+    std::mutex mutex;
+
+    void collect(uint32_t frameIndex);
+    void addSample(const char* name, float milliseconds);
+};
+
+#endif
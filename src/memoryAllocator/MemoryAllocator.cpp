@@ -0,0 +1,243 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Two resources conflict on bufferImageGranularity only if the end of the first
+// and the start of the second fall onto the same "page"
+static bool onSamePage(VkDeviceSize endOfA, VkDeviceSize startOfB, VkDeviceSize pageSize)
+{
+    return (endOfA & ~(pageSize - 1)) == (startOfB & ~(pageSize - 1));
+}
+
+void MemoryAllocator::init(VkDevice device,
+                           const VkPhysicalDeviceMemoryProperties& memProperties,
+                           VkDeviceSize bufferImageGranularity,
+                           VkDeviceSize blockSize)
+{
+    this->device = device;
+    this->memProperties = memProperties;
+    this->bufferImageGranularity = std::max<VkDeviceSize>(bufferImageGranularity, 1);
+    this->blockSize = blockSize;
+}
+
+void MemoryAllocator::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& typeBlocks : blocks) {
+        for (auto& block : typeBlocks) {
+            vkFreeMemory(device, block->memory, nullptr);
+        }
+
+        typeBlocks.clear();
+    }
+}
+
+MemoryAllocator::Block* MemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    std::unique_ptr<Block> block(new Block{});
+
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate memory block!");
+    }
+
+    // host visible blocks stay mapped for their whole lifetime
+    if (memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+            vkFreeMemory(device, block->memory, nullptr);
+            throw std::runtime_error("failed to map memory block!");
+        }
+    }
+
+    block->size = size;
+    block->ranges[0] = Range{size, true, false};
+
+    stats.deviceAllocations++;
+
+    blocks[memoryTypeIndex].push_back(std::move(block));
+
+    return blocks[memoryTypeIndex].back().get();
+}
+
+bool MemoryAllocator::allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, bool linear, VkDeviceSize& offset)
+{
+    for (auto it = block->ranges.begin(); it != block->ranges.end(); it++) {
+        VkDeviceSize rangeStart = it->first;
+        VkDeviceSize rangeEnd = it->first + it->second.size;
+
+        if (!it->second.free || it->second.size < size) {
+            continue;
+        }
+
+        offset = alignUp(rangeStart, alignment);
+
+        // free ranges are always merged, so a neighbouring range is in use
+        if (bufferImageGranularity > 1 && it != block->ranges.begin()) {
+            auto prev = std::prev(it);
+
+            if (prev->second.linear != linear &&
+                onSamePage(prev->first + prev->second.size - 1, offset, bufferImageGranularity)) {
+                offset = alignUp(offset, bufferImageGranularity);
+            }
+        }
+
+        if (offset + size > rangeEnd) {
+            continue;
+        }
+
+        auto next = std::next(it);
+        if (bufferImageGranularity > 1 && next != block->ranges.end() &&
+            next->second.linear != linear &&
+            onSamePage(offset + size - 1, next->first, bufferImageGranularity)) {
+            continue;
+        }
+
+        block->ranges.erase(it);
+
+        if (offset > rangeStart) {
+            block->ranges[rangeStart] = Range{offset - rangeStart, true, false};
+        }
+
+        block->ranges[offset] = Range{size, false, linear};
+
+        if (offset + size < rangeEnd) {
+            block->ranges[offset + size] = Range{rangeEnd - offset - size, true, false};
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& memRequirements, uint32_t memoryTypeIndex, bool linear)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Allocation allocation{};
+    Block* block = nullptr;
+    VkDeviceSize offset = 0;
+
+    for (auto& candidate : blocks[memoryTypeIndex]) {
+        if (allocateFromBlock(candidate.get(), memRequirements.size, memRequirements.alignment, linear, offset)) {
+            block = candidate.get();
+            break;
+        }
+    }
+
+    if (block == nullptr) {
+        // oversized requests get a block of their own
+        block = createBlock(memoryTypeIndex, std::max(blockSize, memRequirements.size));
+
+        if (!allocateFromBlock(block, memRequirements.size, memRequirements.alignment, linear, offset)) {
+            throw std::runtime_error("failed to sub-allocate memory!");
+        }
+    }
+
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = memRequirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+
+    stats.totalAllocations++;
+
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& typeBlocks = blocks[allocation.memoryTypeIndex];
+
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    auto blockIt = std::find_if(typeBlocks.begin(), typeBlocks.end(), [&](const std::unique_ptr<Block>& block) {
+        return block->memory == allocation.memory;
+    });
+
+    if (blockIt == typeBlocks.end()) {
+        throw std::runtime_error("failed to find memory block of allocation!");
+    }
+
+    Block* block = blockIt->get();
+    auto it = block->ranges.find(allocation.offset);
+
+    if (it == block->ranges.end() || it->second.free) {
+        throw std::runtime_error("invalid memory allocation freed!");
+    }
+
+    it->second.free = true;
+    it->second.linear = false;
+
+    auto next = std::next(it);
+    if (next != block->ranges.end() && next->second.free) {
+        it->second.size += next->second.size;
+        block->ranges.erase(next);
+    }
+
+    if (it != block->ranges.begin()) {
+        auto prev = std::prev(it);
+
+        if (prev->second.free) {
+            prev->second.size += it->second.size;
+            block->ranges.erase(it);
+        }
+    }
+
+    // keep one empty block per memory type around to avoid allocation churn
+    if (block->ranges.size() == 1 && typeBlocks.size() > 1) {
+        vkFreeMemory(device, block->memory, nullptr);
+        typeBlocks.erase(blockIt);
+        stats.deviceFrees++;
+    }
+
+    stats.totalFrees++;
+    allocation = Allocation{};
+}
+
+MemoryStats MemoryAllocator::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    MemoryStats current = stats;
+
+    current.blockCount = 0;
+    current.allocationCount = 0;
+    current.freeRangeCount = 0;
+    current.blockBytes = 0;
+    current.usedBytes = 0;
+    current.largestFreeRange = 0;
+
+    for (auto& typeBlocks : blocks) {
+        for (auto& block : typeBlocks) {
+            current.blockCount++;
+            current.blockBytes += block->size;
+
+            for (auto& range : block->ranges) {
+                if (range.second.free) {
+                    current.freeRangeCount++;
+                    current.largestFreeRange = std::max(current.largestFreeRange, range.second.size);
+                }
+                else {
+                    current.allocationCount++;
+                    current.usedBytes += range.second.size;
+                }
+            }
+        }
+    }
+
+    return current;
+}
@@ -0,0 +1,75 @@
+#ifndef _MEMORY_ALLOCATOR_H_
+#define _MEMORY_ALLOCATOR_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+constexpr VkDeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// A sub-range of a pooled VkDeviceMemory block
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    void* mapped = nullptr; // only set for host visible memory
+};
+
+struct MemoryStats {
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    uint32_t freeRangeCount = 0;
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize largestFreeRange = 0;
+    uint64_t deviceAllocations = 0; // lifetime vkAllocateMemory calls
+    uint64_t deviceFrees = 0;
+    uint64_t totalAllocations = 0; // lifetime sub-allocations
+    uint64_t totalFrees = 0;
+};
+
+class MemoryAllocator {
+public:
+    void init(VkDevice device,
+              const VkPhysicalDeviceMemoryProperties& memProperties,
+              VkDeviceSize bufferImageGranularity,
+              VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE);
+    void cleanup();
+    // linear is true for buffers and linear images, false for optimal tiled images
+    Allocation allocate(const VkMemoryRequirements& memRequirements, uint32_t memoryTypeIndex, bool linear);
+    void free(Allocation& allocation);
+    MemoryStats getStats();
+
+private:
+    struct Range {
+        VkDeviceSize size;
+        bool free;
+        bool linear;
+    };
+
+    struct Block {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        void* mapped;
+        // every byte of the block is covered by exactly one range, keyed by offset
+        std::map<VkDeviceSize, Range> ranges;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memProperties{};
+    VkDeviceSize bufferImageGranularity = 1;
+    VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE;
+    std::vector<std::unique_ptr<Block>> blocks[VK_MAX_MEMORY_TYPES];
+    MemoryStats stats;
+    std::mutex mutex;
+
+    Block* createBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+    bool allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, bool linear, VkDeviceSize& offset);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// resolution of the linear to sRGB table, fine enough to round trip every 8 bit value
+constexpr uint32_t LINEAR_STEPS = 8192;
+
+namespace {
+
+struct ConversionTables {
+    float srgbToLinear[256];
+    uint8_t linearToSrgb[LINEAR_STEPS];
+
+    ConversionTables()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+
+            srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (uint32_t i = 0; i < LINEAR_STEPS; i++) {
+            float l = i / static_cast<float>(LINEAR_STEPS - 1);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+
+            linearToSrgb[i] = static_cast<uint8_t>(std::min(c * 255.0f + 0.5f, 255.0f));
+        }
+    }
+};
+
+const ConversionTables& tables()
+{
+    static const ConversionTables instance;
+
+    return instance;
+}
+
+} // namespace
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+
+    return levels;
+}
+
+void downsampleRgba8(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, bool srgb)
+{
+    const ConversionTables& t = tables();
+    uint32_t dstWidth = std::max(width / 2, 1u);
+    uint32_t dstHeight = std::max(height / 2, 1u);
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const uint8_t* row0 = src + static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4;
+        const uint8_t* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+        uint32_t x = 0;
+
+#if defined(__SSE2__)
+        // unorm levels average 4 source texels of both rows in 16 bit lanes, two output texels per step,
+        // srgb levels have to go through linear space below
+        if (!srgb) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi16(2);
+
+            for (; x + 2 <= dstWidth; x += 2) {
+                __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+                __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+                // columns: texels 0 and 1 in lo, 2 and 3 in hi
+                __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+                __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+                // neighbouring columns, the low 4 lanes of each hold one output texel
+                __m128i sum = _mm_unpacklo_epi64(_mm_add_epi16(lo, _mm_srli_si128(lo, 8)),
+                                                 _mm_add_epi16(hi, _mm_srli_si128(hi, 8)));
+
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, sum));
+            }
+        }
+#endif
+
+        for (; x < dstWidth; x++) {
+            const uint8_t* p[4] = {row0 + std::min(x * 2, width - 1) * 4, row0 + std::min(x * 2 + 1, width - 1) * 4,
+                                   row1 + std::min(x * 2, width - 1) * 4, row1 + std::min(x * 2 + 1, width - 1) * 4};
+
+            for (uint32_t c = 0; c < 4; c++) {
+                if (srgb && c < 3) {
+                    const float* decode = t.srgbToLinear;
+                    float average = (decode[p[0][c]] + decode[p[1][c]] + decode[p[2][c]] + decode[p[3][c]]) * 0.25f;
+
+                    out[x * 4 + c] = t.linearToSrgb[static_cast<uint32_t>(average * (LINEAR_STEPS - 1) + 0.5f)];
+                }
+                else {
+                    out[x * 4 + c] = static_cast<uint8_t>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+MipChain buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb)
+{
+    MipChain chain{};
+    size_t size = 0;
+
+    chain.levels.resize(mipLevelCount(width, height));
+
+    for (auto& level : chain.levels) {
+        level.offset = size;
+        level.width = width;
+        level.height = height;
+        size += static_cast<size_t>(width) * height * 4;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    chain.data.resize(size);
+    std::copy(pixels, pixels + static_cast<size_t>(chain.levels[0].width) * chain.levels[0].height * 4, chain.data.begin());
+
+    for (size_t i = 1; i < chain.levels.size(); i++) {
+        const MipLevel& previous = chain.levels[i - 1];
+
+        downsampleRgba8(chain.data.data() + previous.offset, previous.width, previous.height,
+                        chain.data.data() + chain.levels[i].offset, srgb);
+    }
+
+    return chain;
+}
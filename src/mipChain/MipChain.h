@@ -0,0 +1,26 @@
+#ifndef _MIP_CHAIN_H_
+#define _MIP_CHAIN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MipLevel {
+    size_t offset = 0; // into MipChain::data
+    uint32_t width = 0, height = 0;
+};
+
+// Every level of a tightly packed RGBA8 image down to 1x1, stored one after another from level 0
+struct MipChain {
+    std::vector<uint8_t> data;
+    std::vector<MipLevel> levels;
+};
+
+// levels of a full chain for a width x height base level
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+// Halves an RGBA8 level with a 2x2 box filter, an odd last row or column is dropped.
+// srgb filters the color channels in linear space, alpha is always linear.
+void downsampleRgba8(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, bool srgb);
+MipChain buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb);
+
+#endif
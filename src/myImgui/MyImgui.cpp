@@ -22,7 +22,11 @@ MyImgui::MyImgui(VulkanBase* base)
 MyImgui::~MyImgui()
 {
     ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+
+    if (!vulkan->headless) {
+        ImGui_ImplGlfw_Shutdown();
+    }
+
     ImGui::DestroyContext();
 
     vkDestroyDescriptorPool(vulkan->device, descriptorPool, vulkan->allocator);
@@ -72,25 +76,29 @@ void MyImgui::uploadFont()
     ImGui_ImplVulkan_DestroyFontUploadObjects();
 }
 
-void MyImgui::initVulkanResource(VkRenderPass renderPass)
+void MyImgui::initVulkanResource(VkRenderPass renderPass, VkDeviceSize directGeometrySize, uint32_t bindlessTextureCount)
 {
     ImGui_ImplVulkan_InitInfo init_info = {0};
 
     createDescriptorPool();
 
-    ImGui_ImplGlfw_InitForVulkan(vulkan->pWindow.get(), true);
+    if (!vulkan->headless) {
+        ImGui_ImplGlfw_InitForVulkan(vulkan->pWindow.get(), true);
+    }
 
     init_info.Instance = vulkan->instance;
     init_info.PhysicalDevice = vulkan->physicalDevice;
     init_info.Device = vulkan->device;
     init_info.QueueFamily = vulkan->findQueueFamilies(vulkan->physicalDevice).graphicsFamily.value();
     init_info.Queue = vulkan->graphicsQueue;
-    init_info.PipelineCache = nullptr;
+    init_info.PipelineCache = vulkan->pipelineCache;
     init_info.DescriptorPool = descriptorPool;
     init_info.Allocator = vulkan->allocator;
     init_info.MinImageCount = vulkan->minImageCount;
     init_info.ImageCount = vulkan->swapChainImageCount;
     init_info.CheckVkResultFn = check_vk_result;
+    init_info.DirectGeometrySize = directGeometrySize;
+    init_info.BindlessTextureCount = bindlessTextureCount;
     ImGui_ImplVulkan_Init(&init_info, renderPass);
 
     uploadFont();
@@ -99,7 +107,19 @@ void MyImgui::initVulkanResource(VkRenderPass renderPass)
 void MyImgui::newFrame()
 {
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+
+    if (vulkan->headless) {
+        // no platform backend, feed ImGui the target size and a fixed time step
+        ImGuiIO& io = ImGui::GetIO();
+
+        io.DisplaySize = ImVec2(static_cast<float>(vulkan->swapChainExtent.width), static_cast<float>(vulkan->swapChainExtent.height));
+        io.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
+        io.DeltaTime = 1.0f / 60.0f;
+    }
+    else {
+        ImGui_ImplGlfw_NewFrame();
+    }
+
     ImGui::NewFrame();
 }
 
@@ -108,7 +128,7 @@ void MyImgui::endNewFrame()
     ImGui::Render();
 }
 
-void MyImgui::drawFrame(VkCommandBuffer buffer)
+void MyImgui::drawFrame(VkCommandBuffer buffer, ImDrawData* drawData)
 {
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), buffer);
+    ImGui_ImplVulkan_RenderDrawData(drawData, buffer);
 }
\ No newline at end of file
@@ -17,10 +17,12 @@ public:
     MyImgui(VulkanBase* base);
     ~MyImgui();
     void init();
-    void initVulkanResource(VkRenderPass renderPass);
+    // a non zero directGeometrySize lets draw lists write into device memory, a non zero bindlessTextureCount
+    // puts every texture in one descriptor array, see ImGui_ImplVulkan_InitInfo
+    void initVulkanResource(VkRenderPass renderPass, VkDeviceSize directGeometrySize = 0, uint32_t bindlessTextureCount = 0);
     void newFrame();
     void endNewFrame();
-    void drawFrame(VkCommandBuffer buffer);
+    void drawFrame(VkCommandBuffer buffer, ImDrawData* drawData);
     void showDemoWindow() { ImGui::ShowDemoWindow(); }
 
 private:
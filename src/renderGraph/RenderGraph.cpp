@@ -0,0 +1,473 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// accesses whose results have to be made available to later uses
+constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                       VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+void RenderGraph::init(VkDevice device,
+                       MemoryAllocator* allocator,
+                       const VkPhysicalDeviceMemoryProperties& memProperties,
+                       std::function<void(std::function<void()>)> deferDestroy)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->memProperties = memProperties;
+    this->deferDestroy = std::move(deferDestroy);
+}
+
+void RenderGraph::cleanup()
+{
+    for (auto& transient : placed) {
+        vkDestroyImageView(device, transient.view, nullptr);
+        vkDestroyImage(device, transient.image, nullptr);
+    }
+
+    if (transientMemory.memory != VK_NULL_HANDLE) {
+        allocator->free(transientMemory);
+    }
+
+    placed.clear();
+    reset();
+}
+
+void RenderGraph::reset()
+{
+    passes.clear();
+    resources.clear();
+    transients.clear();
+}
+
+RenderResource RenderGraph::importImage(const char* name, VkImage image, VkImageAspectFlags aspect, const ResourceUsage& initial, bool output)
+{
+    Resource resource{};
+
+    resource.name = name;
+    resource.image = image;
+    resource.aspect = aspect;
+    resource.state = initial;
+    resource.output = output;
+    resources.push_back(resource);
+
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::importBuffer(const char* name, VkBuffer buffer, bool output)
+{
+    Resource resource{};
+
+    resource.name = name;
+    resource.buffer = buffer;
+    resource.output = output;
+    resources.push_back(resource);
+
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::createImage(const char* name, const TransientImageInfo& info)
+{
+    Resource resource{};
+    Transient transient{};
+
+    transient.info = info;
+    transients.push_back(transient);
+
+    resource.name = name;
+    resource.aspect = info.aspect;
+    resource.transient = static_cast<int32_t>(transients.size() - 1);
+    resources.push_back(resource);
+
+    return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderPassId RenderGraph::addPass(const char* name, std::function<void(VkCommandBuffer)> execute)
+{
+    Pass pass{};
+
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+
+    return static_cast<RenderPassId>(passes.size() - 1);
+}
+
+void RenderGraph::read(RenderPassId pass, RenderResource resource, const ResourceUsage& usage)
+{
+    passes[pass].uses.push_back(Use{resource, usage, false});
+}
+
+void RenderGraph::write(RenderPassId pass, RenderResource resource, const ResourceUsage& usage)
+{
+    passes[pass].uses.push_back(Use{resource, usage, true});
+}
+
+void RenderGraph::compile()
+{
+    stats = RenderGraphStats{};
+    stats.passes = static_cast<uint32_t>(passes.size());
+
+    cull();
+    placeTransients();
+
+    for (auto& pass : passes) {
+        if (!pass.live) {
+            stats.culledPasses++;
+            continue;
+        }
+
+        for (auto& use : pass.uses) {
+            addBarrier(pass, resources[use.resource], use.usage, use.write);
+        }
+
+        stats.barriers += static_cast<uint32_t>(pass.imageBarriers.size()) + (pass.memoryBarrier ? 1 : 0);
+    }
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+    for (auto& pass : passes) {
+        if (!pass.live) {
+            continue;
+        }
+
+        if (pass.srcStage != 0) {
+            vkCmdPipelineBarrier(commandBuffer, pass.srcStage, pass.dstStage, 0,
+                                 pass.memoryBarrier ? 1 : 0, &pass.memory,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(pass.imageBarriers.size()), pass.imageBarriers.data());
+        }
+
+        pass.execute(commandBuffer);
+    }
+}
+
+VkImage RenderGraph::getImage(RenderResource resource) const
+{
+    const Resource& r = resources[resource];
+
+    return r.transient < 0 ? r.image : transients[r.transient].image;
+}
+
+VkImageView RenderGraph::getImageView(RenderResource resource) const
+{
+    const Resource& r = resources[resource];
+
+    return r.transient < 0 ? VK_NULL_HANDLE : transients[r.transient].view;
+}
+
+// walks the passes backwards, a pass is live if it writes an output or something a
+// later live pass reads before it is written again
+void RenderGraph::cull()
+{
+    std::vector<bool> needed(resources.size());
+
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].output;
+    }
+
+    for (size_t i = passes.size(); i-- > 0;) {
+        Pass& pass = passes[i];
+
+        pass.live = std::any_of(pass.uses.begin(), pass.uses.end(), [&needed](const Use& use) {
+            return use.write && needed[use.resource];
+        });
+
+        if (!pass.live) {
+            continue;
+        }
+
+        for (auto& use : pass.uses) {
+            if (use.write) {
+                needed[use.resource] = false;
+            }
+        }
+
+        for (auto& use : pass.uses) {
+            if (!use.write) {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+// transients used by live passes at overlapping times get disjoint memory, the others may alias
+void RenderGraph::placeTransients()
+{
+    std::vector<Transient*> order;
+    std::vector<Transient*> done;
+    VkDeviceSize heapSize = 0;
+    VkMemoryRequirements heapRequirements{};
+    uint32_t memoryTypeIndex = 0;
+
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        if (!passes[i].live) {
+            continue;
+        }
+
+        for (auto& use : passes[i].uses) {
+            int32_t index = resources[use.resource].transient;
+
+            if (index < 0) {
+                continue;
+            }
+
+            Transient& transient = transients[index];
+
+            if (!transient.used) {
+                transient.used = true;
+                transient.firstPass = i;
+            }
+
+            transient.lastPass = i;
+            transient.stages |= use.usage.stage;
+            transient.writes |= use.usage.access & WRITE_ACCESS;
+        }
+    }
+
+    if (!reusePlacement()) {
+        destroyPlaced();
+        createTransients();
+
+        for (auto& transient : transients) {
+            if (transient.used) {
+                order.push_back(&transient);
+            }
+        }
+
+        std::sort(order.begin(), order.end(), [](const Transient* a, const Transient* b) {
+            return a->memRequirements.size > b->memRequirements.size;
+        });
+
+        heapRequirements.memoryTypeBits = ~0u;
+
+        for (auto transient : order) {
+            VkDeviceSize alignment = transient->memRequirements.alignment;
+            VkDeviceSize offset = 0;
+            bool moved = true;
+
+            // bump past every conflicting range until the transient fits
+            while (moved) {
+                moved = false;
+
+                for (auto other : done) {
+                    bool overlapInTime = transient->firstPass <= other->lastPass && other->firstPass <= transient->lastPass;
+                    bool overlapInMemory = offset < other->offset + other->memRequirements.size &&
+                                           other->offset < offset + transient->memRequirements.size;
+
+                    if (overlapInTime && overlapInMemory) {
+                        offset = (other->offset + other->memRequirements.size + alignment - 1) / alignment * alignment;
+                        moved = true;
+                    }
+                }
+            }
+
+            transient->offset = offset;
+            done.push_back(transient);
+            heapSize = std::max(heapSize, offset + transient->memRequirements.size);
+            heapRequirements.alignment = std::max(heapRequirements.alignment, alignment);
+            heapRequirements.memoryTypeBits &= transient->memRequirements.memoryTypeBits;
+        }
+
+        if (heapSize > 0) {
+            heapRequirements.size = heapSize;
+
+            while (memoryTypeIndex < memProperties.memoryTypeCount &&
+                   !((heapRequirements.memoryTypeBits & (1u << memoryTypeIndex)) &&
+                     (memProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))) {
+                memoryTypeIndex++;
+            }
+
+            if (memoryTypeIndex == memProperties.memoryTypeCount) {
+                throw std::runtime_error("failed to find a memory type for transient images!");
+            }
+
+            transientMemory = allocator->allocate(heapRequirements, memoryTypeIndex, false);
+        }
+
+        for (auto transient : order) {
+            VkImageViewCreateInfo viewInfo{};
+
+            vkBindImageMemory(device, transient->image, transientMemory.memory, transientMemory.offset + transient->offset);
+
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = transient->image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = transient->info.format;
+            viewInfo.subresourceRange.aspectMask = transient->info.aspect;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device, &viewInfo, nullptr, &transient->view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create transient image view!");
+            }
+        }
+
+        placed = transients;
+    }
+
+    for (auto& transient : transients) {
+        if (transient.used) {
+            stats.unaliasedBytes += transient.memRequirements.size;
+        }
+    }
+
+    stats.transientBytes = transientMemory.size;
+
+    // a transient starts the frame after every use of the memory it shares, in this
+    // frame and in the frames still in flight
+    for (auto& resource : resources) {
+        if (resource.transient < 0 || !transients[resource.transient].used) {
+            continue;
+        }
+
+        Transient& transient = transients[resource.transient];
+
+        resource.state = ResourceUsage{};
+
+        for (auto& other : transients) {
+            if (other.used &&
+                transient.offset < other.offset + other.memRequirements.size &&
+                other.offset < transient.offset + transient.memRequirements.size) {
+                resource.state.stage |= other.stages;
+                resource.state.access |= other.writes;
+            }
+        }
+    }
+}
+
+// the last compile's images fit if every transient is declared and used the same way
+bool RenderGraph::reusePlacement()
+{
+    if (placed.size() != transients.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < transients.size(); i++) {
+        const TransientImageInfo& a = transients[i].info;
+        const TransientImageInfo& b = placed[i].info;
+
+        if (a.width != b.width || a.height != b.height || a.format != b.format ||
+            a.usage != b.usage || a.aspect != b.aspect ||
+            transients[i].used != placed[i].used ||
+            transients[i].firstPass != placed[i].firstPass ||
+            transients[i].lastPass != placed[i].lastPass) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < transients.size(); i++) {
+        transients[i].memRequirements = placed[i].memRequirements;
+        transients[i].offset = placed[i].offset;
+        transients[i].image = placed[i].image;
+        transients[i].view = placed[i].view;
+    }
+
+    return true;
+}
+
+void RenderGraph::createTransients()
+{
+    for (auto& transient : transients) {
+        VkImageCreateInfo imageInfo{};
+
+        if (!transient.used) {
+            continue;
+        }
+
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = transient.info.width;
+        imageInfo.extent.height = transient.info.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = transient.info.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = transient.info.usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transient image!");
+        }
+
+        vkGetImageMemoryRequirements(device, transient.image, &transient.memRequirements);
+    }
+}
+
+void RenderGraph::destroyPlaced()
+{
+    std::vector<Transient> retired = std::move(placed);
+    Allocation memory = transientMemory;
+
+    placed.clear();
+    transientMemory = Allocation{};
+
+    if (retired.empty() && memory.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    deferDestroy([this, retired, memory]() mutable {
+        for (auto& transient : retired) {
+            vkDestroyImageView(device, transient.view, nullptr);
+            vkDestroyImage(device, transient.image, nullptr);
+        }
+
+        if (memory.memory != VK_NULL_HANDLE) {
+            allocator->free(memory);
+        }
+    });
+}
+
+// Reads after reads need no barrier. Anything after a write waits for it and sees its
+// results, a write after reads only waits for them, a layout change always transitions.
+void RenderGraph::addBarrier(Pass& pass, Resource& resource, const ResourceUsage& usage, bool write)
+{
+    ResourceUsage& state = resource.state;
+    VkImage image = resource.transient < 0 ? resource.image : transients[resource.transient].image;
+    bool layoutChange = image != VK_NULL_HANDLE && usage.layout != VK_IMAGE_LAYOUT_UNDEFINED && usage.layout != state.layout;
+
+    if (!layoutChange && !(state.access & WRITE_ACCESS) && !(write && state.stage != 0)) {
+        state.stage |= usage.stage;
+        state.access |= usage.access;
+        return;
+    }
+
+    pass.srcStage |= state.stage != 0 ? state.stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    pass.dstStage |= usage.stage;
+
+    if (layoutChange) {
+        VkImageMemoryBarrier barrier{};
+
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = state.access & WRITE_ACCESS;
+        barrier.dstAccessMask = usage.access;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = usage.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = resource.aspect;
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+        pass.imageBarriers.push_back(barrier);
+    }
+    else if (state.access & WRITE_ACCESS) {
+        pass.memoryBarrier = true;
+        pass.memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        pass.memory.srcAccessMask |= state.access & WRITE_ACCESS;
+        pass.memory.dstAccessMask |= usage.access;
+    }
+
+    state.stage = usage.stage;
+    state.access = usage.access;
+
+    if (layoutChange) {
+        state.layout = usage.layout;
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef _RENDER_GRAPH_H_
+#define _RENDER_GRAPH_H_
+
+#include "MemoryAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using RenderResource = uint32_t;
+using RenderPassId = uint32_t;
+
+// How a pass uses a resource. layout is VK_IMAGE_LAYOUT_UNDEFINED for buffers and for
+// attachments whose render pass does its own layout transitions
+struct ResourceUsage {
+    VkPipelineStageFlags stage = 0;
+    VkAccessFlags access = 0;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+const ResourceUsage COLOR_ATTACHMENT_WRITE{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+const ResourceUsage DEPTH_ATTACHMENT_WRITE{VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                                          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+const ResourceUsage FRAGMENT_SAMPLED_READ{VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+const ResourceUsage VERTEX_BUFFER_READ{VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+const ResourceUsage INDEX_BUFFER_READ{VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+const ResourceUsage UNIFORM_BUFFER_READ{VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+
+// An image the graph owns for the frame, its contents do not survive the frame. Only images can be
+// transient, buffers are imported
+struct TransientImageInfo {
+    uint32_t width = 0, height = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkImageUsageFlags usage = 0;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+struct RenderGraphStats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barriers = 0; // image and memory barriers, not vkCmdPipelineBarrier calls
+    VkDeviceSize transientBytes = 0; // backing all transient images, after aliasing
+    VkDeviceSize unaliasedBytes = 0; // the same without aliasing
+};
+
+// Declares one frame as passes reading and writing resources, then records them in
+// declaration order with the barriers between them. Passes whose writes nothing reads
+// are culled, transient images live in one memory range that passes not overlapping in
+// time share. Buffers are only imported, no pass needs a scratch buffer yet, and transient
+// ones would have to keep bufferImageGranularity from the images they alias.
+// Declared again every frame: reset(), import/create, addPass, compile(), execute().
+class RenderGraph {
+public:
+    // deferDestroy runs its argument once the frames recorded so far have retired
+    void init(VkDevice device,
+              MemoryAllocator* allocator,
+              const VkPhysicalDeviceMemoryProperties& memProperties,
+              std::function<void(std::function<void()>)> deferDestroy);
+    // the GPU must be done with every frame using the graph
+    void cleanup();
+    void reset();
+    // initial is the last use before the frame, an output keeps the passes writing it alive
+    RenderResource importImage(const char* name, VkImage image, VkImageAspectFlags aspect, const ResourceUsage& initial, bool output = false);
+    RenderResource importBuffer(const char* name, VkBuffer buffer, bool output = false);
+    RenderResource createImage(const char* name, const TransientImageInfo& info);
+    RenderPassId addPass(const char* name, std::function<void(VkCommandBuffer)> execute);
+    void read(RenderPassId pass, RenderResource resource, const ResourceUsage& usage);
+    // a write replaces the contents, it does not depend on earlier writers
+    void write(RenderPassId pass, RenderResource resource, const ResourceUsage& usage);
+    // culls passes, places transient images and computes the barriers
+    void compile();
+    void execute(VkCommandBuffer commandBuffer);
+    bool isCulled(RenderPassId pass) const { return !passes[pass].live; }
+    // transient images are valid from compile() until the next compile()
+    VkImage getImage(RenderResource resource) const;
+    VkImageView getImageView(RenderResource resource) const;
+    const RenderGraphStats& getStats() const { return stats; }
+
+private:
+    struct Use {
+        RenderResource resource;
+        ResourceUsage usage;
+        bool write;
+    };
+
+    struct Pass {
+        std::string name;
+        std::function<void(VkCommandBuffer)> execute;
+        std::vector<Use> uses;
+        bool live = false;
+        // barriers recorded before the pass
+        VkPipelineStageFlags srcStage = 0;
+        VkPipelineStageFlags dstStage = 0;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        bool memoryBarrier = false;
+        VkMemoryBarrier memory{};
+    };
+
+    struct Resource {
+        std::string name;
+        VkImage image = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkImageAspectFlags aspect = 0;
+        ResourceUsage state; // while compiling, the last use so far
+        bool output = false;
+        int32_t transient = -1; // into transients
+    };
+
+    struct Transient {
+        TransientImageInfo info;
+        bool used = false; // by a live pass
+        uint32_t firstPass = 0, lastPass = 0; // live passes using it, in declaration order
+        VkPipelineStageFlags stages = 0; // of every use
+        VkAccessFlags writes = 0;
+        VkMemoryRequirements memRequirements{};
+        VkDeviceSize offset = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memProperties{};
+    std::function<void(std::function<void()>)> deferDestroy;
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    std::vector<Transient> transients;
+    // images and memory of the last compile, kept while the next frame declares the same transients
+    std::vector<Transient> placed;
+    Allocation transientMemory;
+    RenderGraphStats stats;
+
+    void cull();
+    void placeTransients();
+    bool reusePlacement();
+    void createTransients();
+    void destroyPlaced();
+    void addBarrier(Pass& pass, Resource& resource, const ResourceUsage& usage, bool write);
+};
+
+#endif
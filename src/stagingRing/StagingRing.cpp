@@ -0,0 +1,85 @@
+#include "StagingRing.h"
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void StagingRing::init(VkBuffer buffer, void* mapped, VkDeviceSize size)
+{
+    this->buffer = buffer;
+    this->mapped = static_cast<char*>(mapped);
+    this->size = size;
+    head = 0;
+    tail = 0;
+    spans.clear();
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, UploadTicket ticket, StagingRegion& region)
+{
+    VkDeviceSize offset = alignUp(head, alignment);
+
+    if (spans.empty()) {
+        offset = 0;
+
+        if (size > this->size) {
+            return false;
+        }
+    }
+    else if (head > tail) {
+        // not enough room at the end, wrap around and skip the remainder
+        if (offset + size > this->size) {
+            offset = 0;
+
+            if (size > tail) {
+                return false;
+            }
+        }
+    }
+    else if (offset + size > tail) {
+        // head caught up with tail, this also covers a completely full ring
+        return false;
+    }
+
+    head = offset + size;
+
+    if (!spans.empty() && spans.back().ticket == ticket) {
+        spans.back().end = head;
+    }
+    else {
+        spans.push_back(Span{head, ticket});
+    }
+
+    region.buffer = buffer;
+    region.offset = offset;
+    region.data = mapped + offset;
+
+    return true;
+}
+
+void StagingRing::release(UploadTicket completedTicket)
+{
+    while (!spans.empty() && spans.front().ticket <= completedTicket) {
+        tail = spans.front().end;
+        spans.pop_front();
+    }
+
+    if (spans.empty()) {
+        head = 0;
+        tail = 0;
+    }
+}
+
+UploadTicket StagingRing::oldestTicket() const
+{
+    return spans.empty() ? 0 : spans.front().ticket;
+}
+
+VkDeviceSize StagingRing::bytesInUse() const
+{
+    if (spans.empty()) {
+        return 0;
+    }
+
+    return head > tail ? head - tail : size - tail + head;
+}
@@ -0,0 +1,46 @@
+#ifndef _STAGING_RING_H_
+#define _STAGING_RING_H_
+
+#include "UploadQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+
+// A region of a host visible staging buffer, data points at the mapped bytes of offset
+struct StagingRegion {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void* data = nullptr;
+};
+
+// Hands out regions of one persistently mapped buffer in ring order. A region
+// stays in use until the upload batch that reads it has completed.
+class StagingRing {
+public:
+    void init(VkBuffer buffer, void* mapped, VkDeviceSize size);
+    // returns false when the ring has no room left before the oldest region in use
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, UploadTicket ticket, StagingRegion& region);
+    // recycles the regions of all batches up to completedTicket
+    void release(UploadTicket completedTicket);
+    // ticket of the batch holding the oldest region, 0 if the ring is empty
+    UploadTicket oldestTicket() const;
+    VkDeviceSize capacity() const { return size; }
+    VkDeviceSize bytesInUse() const;
+
+private:
+    // consecutive allocations of one batch share a span
+    struct Span {
+        VkDeviceSize end;
+        UploadTicket ticket;
+    };
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    char* mapped = nullptr;
+    VkDeviceSize size = 0;
+    VkDeviceSize head = 0; // next free byte
+    VkDeviceSize tail = 0; // first byte still in use
+    std::deque<Span> spans;
+};
+
+#endif
@@ -0,0 +1,426 @@
+#include "TextureAtlas.h"
+#include "CpuProfiler.h"
+#include "VulkanBase.h"
+#include "imgui_impl_vulkan.h"
+
+#include <algorithm>
+#include <cstring>
+
+// imgui_draw.cpp keeps its packer static, the atlas has its own copy
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+// skyline of one page, one node per column lets the packer use the full width
+struct AtlasPacker {
+    stbrp_context context;
+    stbrp_node nodes[ATLAS_PAGE_SIZE];
+};
+
+TextureAtlas::TextureAtlas() = default;
+
+TextureAtlas::~TextureAtlas() = default;
+
+void TextureAtlas::init(VulkanBase* base, VkSampler sampler)
+{
+    this->base = base;
+    this->sampler = sampler;
+}
+
+void TextureAtlas::cleanup()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& page : pages) {
+        if (page.textureId != nullptr) {
+            ImGui_ImplVulkan_RemoveTexture(page.textureId);
+        }
+
+        vkDestroyImageView(base->device, page.view, nullptr);
+        base->destroyImage(page.image, page.memory);
+    }
+
+    for (auto& retired : retiredPages) {
+        if (retired.textureId != nullptr) {
+            ImGui_ImplVulkan_RemoveTexture(retired.textureId);
+        }
+
+        vkDestroyImageView(base->device, retired.view, nullptr);
+    }
+
+    pages.clear();
+    retiredPages.clear();
+    images.clear();
+    pending.clear();
+    uploading.clear();
+}
+
+bool TextureAtlas::insert(const std::string& key, const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+    PendingImage image{};
+    uint32_t paddedWidth = width + 2 * ATLAS_PADDING;
+    uint32_t paddedHeight = height + 2 * ATLAS_PADDING;
+
+    if (width == 0 || height == 0 || paddedWidth > ATLAS_PAGE_SIZE || paddedHeight > ATLAS_PAGE_SIZE) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (images.count(key)) {
+            return true;
+        }
+    }
+
+    image.key = key;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+
+    // the padding repeats the nearest edge texel, like clamp to edge addressing would
+    for (uint32_t y = 0; y < paddedHeight; y++) {
+        uint32_t srcY = std::min(std::max(y, ATLAS_PADDING) - ATLAS_PADDING, height - 1);
+        const uint8_t* src = pixels + static_cast<size_t>(srcY) * width * 4;
+        uint8_t* dst = image.pixels.data() + static_cast<size_t>(y) * paddedWidth * 4;
+
+        memcpy(dst + ATLAS_PADDING * 4, src, static_cast<size_t>(width) * 4);
+
+        for (uint32_t x = 0; x < ATLAS_PADDING; x++) {
+            memcpy(dst + x * 4, src, 4);
+            memcpy(dst + (ATLAS_PADDING + width + x) * 4, src + (width - 1) * 4, 4);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // inserted by another thread meanwhile
+    if (!images.emplace(key, Image{}).second) {
+        return true;
+    }
+
+    pending.push_back(std::move(image));
+
+    return true;
+}
+
+bool TextureAtlas::lookup(const std::string& key, AtlasEntry& entry)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = images.find(key);
+
+    if (it == images.end() || it->second.state != State::Resident) {
+        return false;
+    }
+
+    const Image& image = it->second;
+    Page& page = pages[image.page];
+
+    if (page.textureId == nullptr) {
+        return false;
+    }
+
+    page.lastUsed = frame;
+
+    entry.textureId = page.textureId;
+    entry.uv0 = ImVec2(static_cast<float>(image.x) / ATLAS_PAGE_SIZE, static_cast<float>(image.y) / ATLAS_PAGE_SIZE);
+    entry.uv1 = ImVec2(static_cast<float>(image.x + image.width) / ATLAS_PAGE_SIZE, static_cast<float>(image.y + image.height) / ATLAS_PAGE_SIZE);
+
+    return true;
+}
+
+bool TextureAtlas::contains(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return images.count(key) != 0;
+}
+
+void TextureAtlas::newFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& retired : retiredPages) {
+        if (retired.textureId != nullptr) {
+            ImGui_ImplVulkan_RemoveTexture(retired.textureId);
+        }
+
+        vkDestroyImageView(base->device, retired.view, nullptr);
+    }
+
+    retiredPages.clear();
+
+    for (auto& page : pages) {
+        if (page.textureId == nullptr) {
+            page.textureId = ImGui_ImplVulkan_AddTexture(sampler, page.view, VK_IMAGE_LAYOUT_GENERAL);
+        }
+    }
+}
+
+void TextureAtlas::update()
+{
+    CpuZone zone("update texture atlas");
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<PendingImage> batch;
+    std::vector<stbrp_rect> rects;
+    size_t batchSize = 0;
+
+    frame++;
+
+    uploading.erase(std::remove_if(uploading.begin(), uploading.end(), [this](const std::string& key) {
+                        auto it = images.find(key);
+
+                        // pages with copies in flight aren't evicted, this is only a safety net
+                        if (it == images.end() || it->second.state != State::Uploading) {
+                            return true;
+                        }
+
+                        if (!base->uploadQueue.isComplete(it->second.ticket)) {
+                            return false;
+                        }
+
+                        it->second.state = State::Resident;
+                        pages[it->second.page].uploads--;
+
+                        return true;
+                    }),
+                    uploading.end());
+
+    while (!pending.empty() && (batch.empty() || batchSize + pending.front().pixels.size() <= ATLAS_UPLOAD_BUDGET)) {
+        batchSize += pending.front().pixels.size();
+        batch.push_back(std::move(pending.front()));
+        pending.pop_front();
+    }
+
+    for (uint32_t i = 0; i < batch.size(); i++) {
+        stbrp_rect rect{};
+
+        rect.id = static_cast<int>(i);
+        rect.w = static_cast<stbrp_coord>(batch[i].width + 2 * ATLAS_PADDING);
+        rect.h = static_cast<stbrp_coord>(batch[i].height + 2 * ATLAS_PADDING);
+        rects.push_back(rect);
+    }
+
+    // packs as many of the remaining rects as fit into the page and uploads them
+    auto pack = [this, &batch, &rects](uint32_t index) {
+        Page& page = pages[index];
+        std::vector<Placement> placements;
+        std::vector<stbrp_rect> remaining;
+
+        stbrp_pack_rects(&page.packer->context, rects.data(), static_cast<int>(rects.size()));
+
+        for (auto& rect : rects) {
+            if (!rect.was_packed) {
+                remaining.push_back(rect);
+                continue;
+            }
+
+            const PendingImage& pendingImage = batch[rect.id];
+            Image& image = images[pendingImage.key];
+
+            image.state = State::Uploading;
+            image.page = index;
+            image.x = rect.x + ATLAS_PADDING;
+            image.y = rect.y + ATLAS_PADDING;
+            image.width = pendingImage.width;
+            image.height = pendingImage.height;
+            image.ticket = base->uploadQueue.currentTicket();
+            uploading.push_back(pendingImage.key);
+            page.uploads++;
+
+            placements.push_back({&pendingImage, static_cast<uint32_t>(rect.x), static_cast<uint32_t>(rect.y)});
+        }
+
+        if (!placements.empty()) {
+            page.lastUsed = frame;
+            upload(index, placements);
+        }
+
+        rects.swap(remaining);
+    };
+
+    for (uint32_t i = 0; i < pages.size() && !rects.empty(); i++) {
+        pack(i);
+    }
+
+    // the pages are full, grow up to the limit and then start over in the least recently used one
+    while (!rects.empty()) {
+        if (pages.size() < ATLAS_MAX_PAGES) {
+            pages.emplace_back();
+            createPage(pages.back());
+            pack(static_cast<uint32_t>(pages.size() - 1));
+            continue;
+        }
+
+        int index = findEvictablePage();
+
+        // every page is still drawn from, the rest waits for a later update()
+        if (index < 0) {
+            break;
+        }
+
+        evictPage(static_cast<uint32_t>(index));
+        pack(static_cast<uint32_t>(index));
+    }
+
+    for (auto it = rects.rbegin(); it != rects.rend(); it++) {
+        pending.push_front(std::move(batch[it->id]));
+    }
+}
+
+AtlasStats TextureAtlas::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    AtlasStats stats{};
+
+    stats.pages = static_cast<uint32_t>(pages.size());
+    stats.images = images.size() - pending.size();
+    stats.pending = pending.size();
+    stats.evictedPages = evictedPages;
+
+    return stats;
+}
+
+void TextureAtlas::createPage(Page& page)
+{
+    base->createImage(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, 1,
+                      ATLAS_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      page.image, page.memory);
+
+    page.view = base->createImageView(page.image, ATLAS_FORMAT, 1);
+    page.textureId = nullptr;
+    page.packer = std::make_unique<AtlasPacker>();
+    page.lastUsed = frame;
+    page.uploads = 0;
+    page.initialized = false;
+
+    stbrp_init_target(&page.packer->context, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, page.packer->nodes, ATLAS_PAGE_SIZE);
+}
+
+void TextureAtlas::retirePage(Page& page)
+{
+    RetiredPage retired{page.textureId, page.view};
+
+    // runs on the thread submitting frames, the descriptor set is freed by newFrame()
+    base->deletionQueue.push([this, retired]() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        retiredPages.push_back(retired);
+    });
+
+    base->deferDestroyImage(page.image, page.memory);
+}
+
+int TextureAtlas::findEvictablePage()
+{
+    int index = -1;
+
+    for (uint32_t i = 0; i < pages.size(); i++) {
+        if (frame - pages[i].lastUsed < ATLAS_EVICT_AGE || pages[i].uploads != 0) {
+            continue;
+        }
+
+        if (index < 0 || pages[i].lastUsed < pages[index].lastUsed) {
+            index = static_cast<int>(i);
+        }
+    }
+
+    return index;
+}
+
+void TextureAtlas::evictPage(uint32_t index)
+{
+    for (auto it = images.begin(); it != images.end();) {
+        if (it->second.state != State::Pending && it->second.page == index) {
+            it = images.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+
+    retirePage(pages[index]);
+    createPage(pages[index]);
+    evictedPages++;
+}
+
+void TextureAtlas::upload(uint32_t index, const std::vector<Placement>& placements)
+{
+    Page& page = pages[index];
+    VkCommandBuffer commandBuffer = base->uploadQueue.getCommandBuffer();
+    VkImageMemoryBarrier barrier{};
+    VkPipelineStageFlags destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    std::vector<VkBufferImageCopy> regions;
+    VkBuffer buffer = VK_NULL_HANDLE;
+
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = page.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    if (!page.initialized) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        page.initialized = true;
+    }
+
+    // images staged back to back share one copy
+    for (auto& placement : placements) {
+        const PendingImage& image = *placement.image;
+        StagingRegion staging = base->stageData(image.pixels.data(), image.pixels.size());
+        VkBufferImageCopy region{};
+
+        if (staging.buffer != buffer && !regions.empty()) {
+            vkCmdCopyBufferToImage(commandBuffer, buffer, page.image, VK_IMAGE_LAYOUT_GENERAL, static_cast<uint32_t>(regions.size()), regions.data());
+            regions.clear();
+        }
+
+        buffer = staging.buffer;
+
+        region.bufferOffset = staging.offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {static_cast<int32_t>(placement.x), static_cast<int32_t>(placement.y), 0};
+        region.imageExtent = {image.width + 2 * ATLAS_PADDING, image.height + 2 * ATLAS_PADDING, 1};
+        regions.push_back(region);
+    }
+
+    vkCmdCopyBufferToImage(commandBuffer, buffer, page.image, VK_IMAGE_LAYOUT_GENERAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    // frames keep sampling the rest of the page, the layout stays general
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    // a transfer only queue can't name shader stages, the readers wait for the upload ticket instead
+    if (base->uploadQueue.getQueueFamilyIndex() != base->deviceQueueFamilies.graphicsFamily.value()) {
+        barrier.dstAccessMask = 0;
+        destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, destinationStage,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
+}
@@ -0,0 +1,144 @@
+#ifndef _TEXTURE_ATLAS_H_
+#define _TEXTURE_ATLAS_H_
+
+#include "MemoryAllocator.h"
+#include "UploadQueue.h"
+#include "imgui.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// format of every page, inserted images are sRGB RGBA
+constexpr VkFormat ATLAS_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+// side of a square atlas page, texels
+constexpr uint32_t ATLAS_PAGE_SIZE = 1024;
+// texels repeating the edge around every image, so filtering at its border never reads a neighbour
+constexpr uint32_t ATLAS_PADDING = 1;
+// pages kept before the least recently used one is evicted
+constexpr uint32_t ATLAS_MAX_PAGES = 4;
+// a page is evicted only once no lookup has touched it for this many frames, so neither a frame
+// in flight nor a UI frame built ahead in pipelined mode still draws from it
+constexpr uint64_t ATLAS_EVICT_AGE = 8;
+// inserted bytes packed and staged per update()
+constexpr size_t ATLAS_UPLOAD_BUDGET = 4 * 1024 * 1024;
+
+class VulkanBase;
+struct AtlasPacker;
+
+// Where an image of the atlas is drawn from, for ImGui::Image
+struct AtlasEntry {
+    ImTextureID textureId = nullptr;
+    ImVec2 uv0;
+    ImVec2 uv1;
+};
+
+struct AtlasStats {
+    uint32_t pages = 0;
+    size_t images = 0;  // packed, resident or uploading
+    size_t pending = 0; // inserted, not packed yet
+    uint64_t evictedPages = 0;
+};
+
+// Packs small sRGB RGBA images such as icons and thumbnails into a few large pages, so drawing
+// thousands of them binds a handful of textures instead of one each. Images are packed by the
+// skyline packer of imstb_rectpack.h, which can't free space, so eviction works on whole pages:
+// once every page is full the least recently used one is replaced by an empty page and its images
+// are dropped, lookup() misses and the caller inserts them again.
+// Pages stay in the general layout, images are copied next to ones frames in flight are sampling.
+// The ImGui textures of the pages are only added and removed by newFrame(), on the thread building
+// the UI, as they share a descriptor pool with the UI's other textures.
+class TextureAtlas {
+public:
+    TextureAtlas();
+    ~TextureAtlas();
+    void init(VulkanBase* base, VkSampler sampler);
+    // the GPU must be done with every page
+    void cleanup();
+    // thread safe, copies the pixels, the image shows up in lookup() once uploaded,
+    // false when it doesn't fit a page
+    bool insert(const std::string& key, const uint8_t* pixels, uint32_t width, uint32_t height);
+    // thread safe, the entry of an uploaded image, marks its page used by the current frame
+    bool lookup(const std::string& key, AtlasEntry& entry);
+    // thread safe, inserted and not evicted since, i.e. there is no need to insert it again
+    bool contains(const std::string& key);
+    // called on the thread building the UI before it looks images up, adds the ImGui textures
+    // of new pages and removes those of retired ones
+    void newFrame();
+    // called on the thread submitting frames, packs and uploads inserted images within the budget
+    // and evicts pages when every page is full
+    void update();
+    // thread safe
+    AtlasStats getStats();
+
+private:
+    enum class State {
+        Pending,   // waiting for a page
+        Uploading, // placed, its copy is in flight
+        Resident,
+    };
+
+    struct Page {
+        VkImage image = VK_NULL_HANDLE;
+        Allocation memory;
+        VkImageView view = VK_NULL_HANDLE;
+        ImTextureID textureId = nullptr; // added by newFrame(), lookups miss until then
+        std::unique_ptr<AtlasPacker> packer;
+        uint64_t lastUsed = 0;     // frame of the last lookup or placement
+        uint32_t uploads = 0;      // images whose copy is in flight, uploads don't retire with frames
+        bool initialized = false;  // moved to the general layout
+    };
+
+    struct Image {
+        State state = State::Pending;
+        uint32_t page = 0;
+        uint32_t x = 0, y = 0, width = 0, height = 0; // inside the padding
+        UploadTicket ticket = 0;
+    };
+
+    struct PendingImage {
+        std::string key;
+        std::vector<uint8_t> pixels; // padded
+        uint32_t width = 0, height = 0;
+    };
+
+    // a page no frame uses anymore, waiting for newFrame()
+    struct RetiredPage {
+        ImTextureID textureId = nullptr;
+        VkImageView view = VK_NULL_HANDLE;
+    };
+
+    // where the padded pixels of an image go in a page
+    struct Placement {
+        const PendingImage* image = nullptr;
+        uint32_t x = 0, y = 0;
+    };
+
+    VulkanBase* base = nullptr;
+    VkSampler sampler = VK_NULL_HANDLE;
+    std::vector<Page> pages;
+    std::unordered_map<std::string, Image> images;
+    std::deque<PendingImage> pending;
+    std::vector<std::string> uploading;
+    std::vector<RetiredPage> retiredPages;
+    uint64_t frame = 0;
+    uint64_t evictedPages = 0;
+    std::mutex mutex;
+
+    void createPage(Page& page);
+    // the page's image is destroyed and its texture handed to newFrame() once the frame being
+    // recorded has retired
+    void retirePage(Page& page);
+    // the least recently used page no frame may still draw from, -1 if there is none
+    int findEvictablePage();
+    void evictPage(uint32_t index);
+    void upload(uint32_t index, const std::vector<Placement>& placements);
+};
+
+#endif
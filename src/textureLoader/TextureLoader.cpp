@@ -0,0 +1,364 @@
+#include "TextureLoader.h"
+#include "CpuProfiler.h"
+#include "VulkanBase.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <fstream>
+
+constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+void TextureLoader::init(VulkanBase* base, uint32_t threadCount)
+{
+    this->base = base;
+    gpuMipmaps = base->canBlitMipmaps(TEXTURE_FORMAT);
+
+    createPlaceholder();
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&TextureLoader::workerLoop, this, i);
+    }
+}
+
+void TextureLoader::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    workers.clear();
+
+    for (auto& texture : textures) {
+        if (texture.image != VK_NULL_HANDLE) {
+            vkDestroyImageView(base->device, texture.view, nullptr);
+            base->destroyImage(texture.image, texture.memory);
+        }
+    }
+
+    textures.clear();
+    decodeJobs.clear();
+    decoded.clear();
+    uploading.clear();
+
+    vkDestroyImageView(base->device, placeholderView, nullptr);
+    base->destroyImage(placeholderImage, placeholderMemory);
+}
+
+TextureHandle TextureLoader::load(const std::string& path)
+{
+    TextureHandle handle = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        handle = static_cast<TextureHandle>(textures.size());
+        textures.emplace_back();
+        textures.back().path = path;
+        decodeJobs.push_back(handle);
+    }
+
+    jobAvailable.notify_one();
+
+    return handle;
+}
+
+std::vector<TextureHandle> TextureLoader::update()
+{
+    std::vector<TextureHandle> resident;
+    std::vector<DecodedTexture> batch;
+    size_t batchSize = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto it = uploading.begin(); it != uploading.end();) {
+            Texture& texture = textures[*it];
+
+            if (!base->uploadQueue.isComplete(texture.ticket)) {
+                it++;
+                continue;
+            }
+
+            texture.state = State::Resident;
+            resident.push_back(*it);
+            it = uploading.erase(it);
+        }
+
+        // at least one texture per call, however large
+        while (!decoded.empty() && (batch.empty() || batchSize + decoded.front().size <= TEXTURE_UPLOAD_BUDGET)) {
+            batchSize += decoded.front().size;
+            batch.push_back(std::move(decoded.front()));
+            decoded.pop_front();
+        }
+    }
+
+    for (auto& texture : batch) {
+        upload(texture);
+    }
+
+    return resident;
+}
+
+VkImageView TextureLoader::getView(TextureHandle handle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return textures[handle].state == State::Resident ? textures[handle].view : placeholderView;
+}
+
+bool TextureLoader::isResident(TextureHandle handle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return textures[handle].state == State::Resident;
+}
+
+bool TextureLoader::hasFailed(TextureHandle handle)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return textures[handle].state == State::Failed;
+}
+
+size_t TextureLoader::getPendingCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return std::count_if(textures.begin(), textures.end(), [](const Texture& texture) {
+        return texture.state != State::Resident && texture.state != State::Failed;
+    });
+}
+
+// a mid grey texel, uploaded with the startup batch
+void TextureLoader::createPlaceholder()
+{
+    const uint8_t texel[4] = {128, 128, 128, 255};
+    StagingRegion staging = base->stageData(texel, sizeof(texel));
+
+    base->createImage(1, 1, 1,
+                      TEXTURE_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+                      VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      placeholderImage, placeholderMemory);
+
+    base->transitionImageLayout(placeholderImage, TEXTURE_FORMAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+
+    base->copyBufferToImage(staging.buffer, placeholderImage, 1, 1, staging.offset);
+
+    base->transitionImageLayout(placeholderImage, TEXTURE_FORMAT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+
+    placeholderView = base->createImageView(placeholderImage, TEXTURE_FORMAT, 1);
+}
+
+void TextureLoader::workerLoop(uint32_t threadIndex)
+{
+    CpuProfiler::setThreadName("texture loader " + std::to_string(threadIndex));
+
+    while (true) {
+        TextureHandle handle = 0;
+        std::string path;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            jobAvailable.wait(lock, [this]() { return stopping || !decodeJobs.empty(); });
+
+            if (stopping) {
+                return;
+            }
+
+            handle = decodeJobs.front();
+            decodeJobs.pop_front();
+            path = textures[handle].path;
+        }
+
+        decode(handle, path);
+    }
+}
+
+void TextureLoader::decode(TextureHandle handle, const std::string& path)
+{
+    CpuZone zone("decode texture");
+    DecodedTexture texture{};
+    bool loaded = false;
+
+    texture.handle = handle;
+
+    if (path.size() > COOKED_TEXTURE_EXTENSION.size() &&
+        path.compare(path.size() - COOKED_TEXTURE_EXTENSION.size(), COOKED_TEXTURE_EXTENSION.size(), COOKED_TEXTURE_EXTENSION) == 0) {
+        loaded = mapCooked(path, texture);
+    }
+    else {
+        loaded = decodeImage(path, texture);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!loaded) {
+            textures[handle].state = State::Failed;
+            return;
+        }
+
+        textures[handle].state = State::Decoded;
+        decoded.push_back(std::move(texture));
+    }
+}
+
+bool TextureLoader::decodeImage(const std::string& path, DecodedTexture& texture)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    std::vector<stbi_uc> bytes;
+    int texWidth = 0, texHeight = 0, texChannels = 0;
+    stbi_uc* pixels = nullptr;
+
+    if (file.is_open()) {
+        bytes.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+
+        pixels = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    }
+
+    if (!pixels) {
+        return false;
+    }
+
+    texture.format = TEXTURE_FORMAT;
+    texture.mipLevels = mipLevelCount(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+
+    if (gpuMipmaps) {
+        texture.chain.levels.push_back(MipLevel{0, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight)});
+        texture.chain.data.assign(pixels, pixels + static_cast<size_t>(texWidth) * texHeight * 4);
+    }
+    else {
+        texture.chain = buildMipChain(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), true);
+    }
+
+    stbi_image_free(pixels);
+
+    texture.data = texture.chain.data.data();
+    texture.size = texture.chain.data.size();
+
+    return true;
+}
+
+// no decode, the levels are staged straight from the mapping
+bool TextureLoader::mapCooked(const std::string& path, DecodedTexture& texture)
+{
+    auto file = std::make_unique<CookedTextureFile>();
+    const CookedPayload* payload = nullptr;
+    const CookedLevel* last = nullptr;
+
+    try {
+        file->open(path);
+    }
+    catch (const std::runtime_error&) {
+        return false;
+    }
+
+    const CookedTextureHeader& header = file->getHeader();
+
+    // the file is self consistent, the device still has to be able to create it
+    if (header.width > base->deviceProperties.limits.maxImageDimension2D ||
+        header.height > base->deviceProperties.limits.maxImageDimension2D) {
+        return false;
+    }
+
+    // payloads are stored preferred first
+    for (uint32_t i = 0; i < header.payloadCount && payload == nullptr; i++) {
+        if (canSample(static_cast<VkFormat>(file->getPayload(i).format))) {
+            payload = &file->getPayload(i);
+        }
+    }
+
+    if (payload == nullptr) {
+        return false;
+    }
+
+    texture.format = static_cast<VkFormat>(payload->format);
+    texture.mipLevels = header.mipLevels;
+
+    for (uint32_t i = 0; i < header.mipLevels; i++) {
+        texture.chain.levels.push_back(MipLevel{static_cast<size_t>(payload->levels[i].offset - payload->levels[0].offset),
+                                                std::max(header.width >> i, 1u),
+                                                std::max(header.height >> i, 1u)});
+    }
+
+    last = &payload->levels[header.mipLevels - 1];
+    texture.data = file->getData(payload->levels[0].offset);
+    texture.size = static_cast<size_t>(last->offset + last->size - payload->levels[0].offset);
+    texture.cooked = std::move(file);
+
+    return true;
+}
+
+bool TextureLoader::canSample(VkFormat format)
+{
+    VkFormatProperties formatProperties{};
+
+    if (format != TEXTURE_FORMAT && !base->textureCompressionBCSupported) {
+        return false;
+    }
+
+    vkGetPhysicalDeviceFormatProperties(base->physicalDevice, format, &formatProperties);
+
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+void TextureLoader::upload(DecodedTexture& texture)
+{
+    CpuZone zone("upload texture");
+    const MipLevel& top = texture.chain.levels[0];
+    bool generateMips = texture.chain.levels.size() < texture.mipLevels;
+    StagingRegion staging = base->stageData(texture.data, texture.size);
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    VkImage image = VK_NULL_HANDLE;
+    Allocation memory;
+    VkImageView view = VK_NULL_HANDLE;
+
+    if (generateMips) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    base->createImage(top.width, top.height, texture.mipLevels,
+                      texture.format, VK_IMAGE_TILING_OPTIMAL,
+                      usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      image, memory);
+
+    base->transitionImageLayout(image, texture.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.mipLevels);
+
+    for (uint32_t i = 0; i < texture.chain.levels.size(); i++) {
+        const MipLevel& level = texture.chain.levels[i];
+
+        base->copyBufferToImage(staging.buffer, image, level.width, level.height, staging.offset + level.offset, i);
+    }
+
+    if (generateMips) {
+        base->generateMipmaps(image, top.width, top.height, texture.mipLevels);
+    }
+    else {
+        base->transitionImageLayout(image, texture.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture.mipLevels);
+    }
+
+    view = base->createImageView(image, texture.format, texture.mipLevels);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Texture& entry = textures[texture.handle];
+
+        entry.image = image;
+        entry.memory = memory;
+        entry.view = view;
+        entry.ticket = base->uploadQueue.currentTicket();
+        entry.state = State::Uploading;
+        uploading.push_back(texture.handle);
+    }
+}
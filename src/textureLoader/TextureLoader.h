@@ -0,0 +1,104 @@
+#ifndef _TEXTURE_LOADER_H_
+#define _TEXTURE_LOADER_H_
+
+#include "CookedTexture.h"
+#include "MemoryAllocator.h"
+#include "MipChain.h"
+#include "UploadQueue.h"
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// upper bound of threads decoding textures
+constexpr uint32_t MAX_TEXTURE_LOAD_THREADS = 4;
+// decoded bytes staged per update(), so a burst of loads neither stalls a frame on the
+// staging ring nor makes one upload batch huge
+constexpr size_t TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024;
+
+typedef uint32_t TextureHandle;
+
+class VulkanBase;
+
+// Loads sRGB textures in the background. Files are read and decoded on a pool of worker
+// threads, then staged and uploaded in batches by update() on the thread submitting frames.
+// Cooked textures (.ctex) are mapped instead and their mips staged as is, in the first format
+// of the file the device can sample. A handle's view is a placeholder until its texture is resident.
+class TextureLoader {
+public:
+    void init(VulkanBase* base, uint32_t threadCount);
+    // the GPU must be done with every texture
+    void cleanup();
+    // thread safe, decoding starts right away
+    TextureHandle load(const std::string& path);
+    // called on the thread submitting frames, uploads decoded textures within the budget and
+    // returns the ones that became resident since the last call
+    std::vector<TextureHandle> update();
+    // the following are thread safe
+    VkImageView getView(TextureHandle handle);
+    bool isResident(TextureHandle handle);
+    bool hasFailed(TextureHandle handle);
+    // textures neither resident nor failed
+    size_t getPendingCount();
+
+private:
+    enum class State {
+        Decoding,
+        Decoded,
+        Uploading,
+        Resident,
+        Failed
+    };
+
+    struct Texture {
+        std::string path;
+        State state = State::Decoding;
+        VkImage image = VK_NULL_HANDLE;
+        Allocation memory;
+        VkImageView view = VK_NULL_HANDLE;
+        UploadTicket ticket = 0;
+    };
+
+    struct DecodedTexture {
+        TextureHandle handle = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t mipLevels = 1;
+        MipChain chain; // level 0 only when the GPU generates the others
+        // a cooked texture's levels stay in the mapped file, chain.data is left empty
+        std::unique_ptr<CookedTextureFile> cooked;
+        // what is staged, level offsets are relative to it
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    VulkanBase* base = nullptr;
+    bool gpuMipmaps = false;
+    VkImage placeholderImage = VK_NULL_HANDLE;
+    Allocation placeholderMemory;
+    VkImageView placeholderView = VK_NULL_HANDLE;
+    std::deque<Texture> textures; // indexed by handle, references stay valid as it grows
+    std::deque<TextureHandle> decodeJobs;
+    std::deque<DecodedTexture> decoded;
+    std::vector<TextureHandle> uploading;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+
+    void createPlaceholder();
+    void workerLoop(uint32_t threadIndex);
+    void decode(TextureHandle handle, const std::string& path);
+    bool decodeImage(const std::string& path, DecodedTexture& texture);
+    bool mapCooked(const std::string& path, DecodedTexture& texture);
+    bool canSample(VkFormat format);
+    void upload(DecodedTexture& texture);
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "UploadQueue.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void UploadQueue::init(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, bool useTimelineSemaphore, FrameTimeline* frameTimeline)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+
+    this->device = device;
+    this->queue = queue;
+    this->queueFamilyIndex = queueFamilyIndex;
+    this->frameTimeline = frameTimeline;
+
+    timeline.init(device, useTimelineSemaphore);
+
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+}
+
+void UploadQueue::cleanup()
+{
+    wait(submit());
+
+    freeBatches.clear();
+
+    // every frame has completed by now
+    for (auto& waited : waitedSemaphores) {
+        freeSemaphores.push_back(waited.semaphore);
+    }
+
+    freeSemaphores.insert(freeSemaphores.end(), signalledSemaphores.begin(), signalledSemaphores.end());
+
+    for (VkSemaphore semaphore : freeSemaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+
+    waitedSemaphores.clear();
+    signalledSemaphores.clear();
+    freeSemaphores.clear();
+
+    timeline.cleanup();
+
+    vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+VkSemaphore UploadQueue::acquireSemaphore()
+{
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+
+    if (!freeSemaphores.empty()) {
+        semaphore = freeSemaphores.back();
+        freeSemaphores.pop_back();
+
+        return semaphore;
+    }
+
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload semaphore!");
+    }
+
+    return semaphore;
+}
+
+UploadQueue::Batch UploadQueue::acquireBatch()
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    Batch batch{};
+
+    if (!freeBatches.empty()) {
+        batch = std::move(freeBatches.back());
+        freeBatches.pop_back();
+
+        return batch;
+    }
+
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    return batch;
+}
+
+VkCommandBuffer UploadQueue::getCommandBuffer()
+{
+    VkCommandBufferBeginInfo beginInfo{};
+
+    if (!isRecording) {
+        recording = acquireBatch();
+        recording.ticket = timeline.reserve();
+
+        if (!timeline.usesTimelineSemaphore()) {
+            recording.semaphore = acquireSemaphore();
+        }
+
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(recording.commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording upload command buffer!");
+        }
+
+        isRecording = true;
+    }
+
+    return recording.commandBuffer;
+}
+
+UploadTicket UploadQueue::currentTicket()
+{
+    getCommandBuffer();
+
+    return recording.ticket;
+}
+
+void UploadQueue::onComplete(std::function<void()> callback)
+{
+    // make sure the callback belongs to a batch that will be submitted
+    getCommandBuffer();
+
+    recording.callbacks.push_back(std::move(callback));
+}
+
+UploadTicket UploadQueue::submit()
+{
+    VkSubmitInfo submitInfo{};
+
+    if (!isRecording) {
+        return lastTicket;
+    }
+
+    if (vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &recording.commandBuffer;
+
+    // without timeline semaphores the frames see the batch's writes through this one
+    if (recording.semaphore != VK_NULL_HANDLE) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &recording.semaphore;
+    }
+
+    timeline.submit(queue, submitInfo, recording.ticket);
+
+    lastTicket = recording.ticket;
+    inFlight.push_back(std::move(recording));
+    recording = Batch{};
+    isRecording = false;
+
+    return lastTicket;
+}
+
+void UploadQueue::finishBatch(Batch& batch)
+{
+    for (auto& callback : batch.callbacks) {
+        callback();
+    }
+
+    batch.callbacks.clear();
+}
+
+void UploadQueue::retire()
+{
+    UploadTicket completed = timeline.poll();
+
+    while (!inFlight.empty() && inFlight.front().ticket <= completed) {
+        finishBatch(inFlight.front());
+
+        if (inFlight.front().semaphore != VK_NULL_HANDLE) {
+            signalledSemaphores.push_back(inFlight.front().semaphore);
+            inFlight.front().semaphore = VK_NULL_HANDLE;
+        }
+
+        freeBatches.push_back(std::move(inFlight.front()));
+        inFlight.pop_front();
+    }
+
+    while (!waitedSemaphores.empty() && frameTimeline->isComplete(waitedSemaphores.front().frameValue)) {
+        freeSemaphores.push_back(waitedSemaphores.front().semaphore);
+        waitedSemaphores.pop_front();
+    }
+}
+
+void UploadQueue::addFrameWaits(uint64_t frameValue,
+                                std::vector<VkSemaphore>& semaphores,
+                                std::vector<VkPipelineStageFlags>& stages,
+                                std::vector<uint64_t>& values)
+{
+    // one wait on the latest completed ticket covers every batch before it
+    if (timeline.usesTimelineSemaphore()) {
+        if (getCompletedTicket() != 0) {
+            semaphores.push_back(timeline.getSemaphore());
+            stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            values.push_back(getCompletedTicket());
+        }
+
+        return;
+    }
+
+    // a binary semaphore is waited on exactly once, by the first frame after its batch completed
+    for (VkSemaphore semaphore : signalledSemaphores) {
+        semaphores.push_back(semaphore);
+        stages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        values.push_back(0);
+        waitedSemaphores.push_back({frameValue, semaphore});
+    }
+
+    signalledSemaphores.clear();
+}
+
+bool UploadQueue::isComplete(UploadTicket ticket)
+{
+    if (ticket > getCompletedTicket()) {
+        retire();
+    }
+
+    return ticket <= getCompletedTicket();
+}
+
+void UploadQueue::wait(UploadTicket ticket)
+{
+    if (isRecording && ticket >= recording.ticket) {
+        submit();
+    }
+
+    timeline.wait(std::min(ticket, lastTicket));
+    retire();
+}
@@ -0,0 +1,85 @@
+#ifndef _UPLOAD_QUEUE_H_
+#define _UPLOAD_QUEUE_H_
+
+#include "FrameTimeline.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Upload timeline value of a batch, complete once the batch has executed on the GPU
+typedef uint64_t UploadTicket;
+
+// Batches transfer commands into one submission tracked on a timeline of its own,
+// so recording an upload never stalls the queue and a transfer queue never waits
+// for frames (nor frames for it). A batch reserves its ticket when it begins
+// recording. Frames only wait for uploads that have already completed, see
+// addFrameWaits().
+// Not thread safe, it is driven from the thread that submits frames.
+class UploadQueue {
+public:
+    // frameTimeline tells when a frame that waited on a batch is done with its semaphore
+    void init(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, bool useTimelineSemaphore, FrameTimeline* frameTimeline);
+    void cleanup();
+    // command buffer of the batch being recorded, begun on first use
+    VkCommandBuffer getCommandBuffer();
+    // ticket the batch being recorded will complete with, begins the batch if needed
+    UploadTicket currentTicket();
+    // called once the batch being recorded has completed, e.g. to release staging memory
+    void onComplete(std::function<void()> callback);
+    // submits the batch being recorded, returns its ticket (or the last submitted one if it was empty)
+    UploadTicket submit();
+    bool isComplete(UploadTicket ticket);
+    void wait(UploadTicket ticket);
+    // polls in-flight batches and runs the callbacks of the completed ones
+    void retire();
+    // adds the semaphore waits that make every upload completed so far visible to the frame
+    // submitted with frameValue, i.e. everything its recording could have seen complete.
+    // They are signalled already, so the frame never stalls on an upload still running.
+    void addFrameWaits(uint64_t frameValue,
+                       std::vector<VkSemaphore>& semaphores,
+                       std::vector<VkPipelineStageFlags>& stages,
+                       std::vector<uint64_t>& values);
+    // every ticket up to this one has completed
+    UploadTicket getCompletedTicket() const { return timeline.completedValue(); }
+    uint32_t getQueueFamilyIndex() const { return queueFamilyIndex; }
+
+private:
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        UploadTicket ticket = 0;
+        std::vector<std::function<void()>> callbacks;
+        VkSemaphore semaphore = VK_NULL_HANDLE; // fence mode, signalled for the frames
+    };
+
+    // fence mode, a binary semaphore a frame waits on, free again once that frame has completed
+    struct WaitedSemaphore {
+        uint64_t frameValue;
+        VkSemaphore semaphore;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueFamilyIndex = 0;
+    FrameTimeline timeline;
+    FrameTimeline* frameTimeline = nullptr;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    Batch recording;
+    bool isRecording = false;
+    std::deque<Batch> inFlight;
+    std::vector<Batch> freeBatches;
+    UploadTicket lastTicket = 0; // last submitted batch
+    // fence mode, semaphores of completed batches no frame waited on yet
+    std::vector<VkSemaphore> signalledSemaphores;
+    std::deque<WaitedSemaphore> waitedSemaphores;
+    std::vector<VkSemaphore> freeSemaphores;
+
+    Batch acquireBatch();
+    VkSemaphore acquireSemaphore();
+    void finishBatch(Batch& batch);
+};
+
+#endif
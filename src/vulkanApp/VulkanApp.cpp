@@ -8,7 +8,9 @@
 #include "stb_image.h"
 
 #define GLM_FORCE_RADIANS
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -33,47 +35,94 @@ static std::vector<char> readFile(const std::string& filename)
     return buffer;
 }
 
+// a disc in a color picked by the index, sides vary so pages don't pack evenly
+static std::vector<uint8_t> generateIcon(uint32_t index, uint32_t& side)
+{
+    float r = 0.0f, g = 0.0f, b = 0.0f;
+    float radius = 0.0f;
+    std::vector<uint8_t> pixels;
+
+    side = 16 + (index * 7) % 33;
+    radius = side * 0.5f;
+    pixels.resize(side * side * 4, 0);
+
+    ImGui::ColorConvertHSVtoRGB(fmodf(index * 0.618034f, 1.0f), 0.7f, 0.9f, r, g, b);
+
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            float dx = x + 0.5f - radius;
+            float dy = y + 0.5f - radius;
+            uint8_t* texel = pixels.data() + (y * side + x) * 4;
+
+            if (dx * dx + dy * dy > radius * radius) {
+                continue;
+            }
+
+            texel[0] = static_cast<uint8_t>(r * 255.0f);
+            texel[1] = static_cast<uint8_t>(g * 255.0f);
+            texel[2] = static_cast<uint8_t>(b * 255.0f);
+            texel[3] = 255;
+        }
+    }
+
+    return pixels;
+}
+
 VulkanApp::~VulkanApp()
 {
+    // retired offscreen targets return to the pool, which is destroyed below, and no
+    // upload may still be writing to a texture destroyed here
+    frameTimeline.wait(frameTimeline.submittedValue());
+    uploadQueue.wait(uploadQueue.submit());
+    deletionQueue.flush();
+
     //offscreen
     vkDestroyPipeline(device, offscreenPass.pipeline, nullptr);
-    vkDestroyFramebuffer(device, offscreenPass.frameBuffer, nullptr);
-    vkDestroyImageView(device, offscreenPass.color.view, nullptr);
-    vkDestroyImage(device, offscreenPass.color.image, nullptr);
-    vkFreeMemory(device, offscreenPass.color.mem, nullptr);
+    vkDestroyFramebuffer(device, offscreenFramebuffer.frameBuffer, nullptr);
+    destroyOffscreenTarget(offscreenPass.view.target);
+
+    for (auto& target : replacedTargets) {
+        destroyOffscreenTarget(target);
+    }
+
+    for (auto& target : offscreenPool) {
+        destroyOffscreenTarget(target);
+    }
+
     vkDestroyRenderPass(device, offscreenPass.renderPass, nullptr);
 
+    renderGraph.cleanup();
+
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 
-    vkDestroySampler(device, textureSampler, nullptr);
+    textureAtlas.cleanup();
 
-    vkDestroyImageView(device, textureImageView, nullptr);
+    vkDestroySampler(device, textureSampler, nullptr);
 
-    vkDestroyImage(device, textureImage, nullptr);
-    vkFreeMemory(device, textureImageMemory, nullptr);
+    textureLoader.cleanup();
 
     vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-    vkDestroyBuffer(device, indexBuffer, nullptr);
-    vkFreeMemory(device, indexBufferMemory, nullptr);
+    destroyBuffer(indexBuffer, indexBufferMemory);
 
-    vkDestroyBuffer(device, vertexBuffer, nullptr);
-    vkFreeMemory(device, vertexBufferMemory, nullptr);
+    destroyBuffer(vertexBuffer, vertexBufferMemory);
 
-    vkDestroyBuffer(device, uniformBuffers, nullptr);
-    vkFreeMemory(device, uniformBuffersMemory, nullptr);
+    destroyBuffer(uniformBuffers, uniformBuffersMemory);
 
     vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 }
 
 void VulkanApp::prepare()
 {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
     VulkanBase::initVulkan();
 
     createDescriptorSetLayout();
+    textureLoader.init(this, std::clamp(std::thread::hardware_concurrency(), 1u, MAX_TEXTURE_LOAD_THREADS));
     createTextureImage();
-    createTextureImageView();
     createTextureSampler();
+    textureAtlas.init(this, textureSampler);
     createVertexBuffer();
     createIndexBuffer();
     createUniformBuffers();
@@ -81,57 +130,92 @@ void VulkanApp::prepare()
     createDescriptorSets();
     prepareImgui();
     prepareOffscreen();
+
+    renderGraph.init(device, &memoryAllocator, memProperties, [this](std::function<void()> destroy) {
+        deletionQueue.push(std::move(destroy));
+    });
+
+    // one wait for every startup upload instead of a queue drain per copy
+    uploadQueue.wait(uploadQueue.submit());
+
+    startupTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    std::cout << "startup took " << startupTime << " ms, pipeline cache "
+              << (pipelineCacheLoadedSize ? "reused " + std::to_string(pipelineCacheLoadedSize) + " bytes" : "was cold")
+              << std::endl;
 }
 
-void VulkanApp::buildCommandBuffer(uint32_t index)
+void VulkanApp::buildCommandBuffer(uint32_t index, ImDrawData* drawData, const OffscreenView& offscreen)
 {
     VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = 0;                  // Optional
-    beginInfo.pInheritanceInfo = nullptr; // Optional
-
-    if (vkBeginCommandBuffer(commandBuffers[index], &beginInfo) != VK_SUCCESS) {
-        throw std::runtime_error("failed to begin recording command buffer!");
-    }
-
-    {
+    VkCommandBufferInheritanceInfo offscreenInheritance{};
+    VkCommandBufferInheritanceInfo imguiInheritance{};
+    std::vector<VkCommandBuffer> secondaryBuffers;
+    VkCommandBuffer primaryBuffer = VK_NULL_HANDLE;
+    size_t offscreenJob = 0;
+    size_t imguiJob = 0;
+    uint32_t frameScope = 0;
+    RenderResource offscreenColor = 0;
+    RenderResource offscreenDepth = 0;
+    RenderResource backBuffer = 0;
+    RenderResource vertexData = 0;
+    RenderResource indexData = 0;
+    RenderResource uniformData = 0;
+    RenderPassId offscreenPassId = 0;
+    RenderPassId imguiPassId = 0;
+    VkFramebuffer offscreenFrameBuffer = VK_NULL_HANDLE;
+
+    // frames are recorded in order, so no later frame uses a target replaced before this one's
+    retireReplacedTargets(offscreen.target.generation);
+
+    // the offscreen color target was last sampled by an earlier frame, its contents are cleared
+    renderGraph.reset();
+    offscreenColor = renderGraph.importImage("offscreen color", offscreen.target.color.image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                             ResourceUsage{VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED});
+    // depth only lives through the offscreen pass, the graph places it in its transient memory
+    offscreenDepth = renderGraph.createImage("offscreen depth", TransientImageInfo{offscreen.target.width, offscreen.target.height,
+                                                                                   OFFSCREEN_DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                                                                   VK_IMAGE_ASPECT_DEPTH_BIT});
+    // the swap chain render pass synchronizes with acquire and present itself
+    backBuffer = renderGraph.importImage("back buffer", swapChainImages[index], VK_IMAGE_ASPECT_COLOR_BIT, ResourceUsage{}, true);
+    vertexData = renderGraph.importBuffer("vertices", vertexBuffer);
+    indexData = renderGraph.importBuffer("indices", indexBuffer);
+    uniformData = renderGraph.importBuffer("uniforms", uniformBuffers);
+
+    offscreenPassId = renderGraph.addPass("offscreen pass", [&](VkCommandBuffer commandBuffer) {
+        uint32_t scope = gpuProfiler.beginScope(commandBuffer, "offscreen pass");
         VkRenderPassBeginInfo renderPassInfo{};
-        VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-        VkViewport viewport = createViewport(static_cast<float>(offscreenPass.width), static_cast<float>(offscreenPass.height), 0.0f, 1.0f);
-        VkRect2D scissor = createRect2D(offscreenPass.width, offscreenPass.height, 0, 0);
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
+        std::array<VkClearValue, 2> clearValues{};
+
+        clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        clearValues[1].depthStencil = {1.0f, 0};
 
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = offscreenPass.renderPass;
-        renderPassInfo.framebuffer = offscreenPass.frameBuffer;
+        renderPassInfo.framebuffer = offscreenFrameBuffer;
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent.width = offscreenPass.width;
-        renderPassInfo.renderArea.extent.height = offscreenPass.height;
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
-        vkCmdBeginRenderPass(commandBuffers[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        renderPassInfo.renderArea.extent.width = offscreen.width;
+        renderPassInfo.renderArea.extent.height = offscreen.height;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdSetViewport(commandBuffers[index], 0, 1, &viewport);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-        
-        vkCmdSetScissor(commandBuffers[index], 0, 1, &scissor);
+        vkCmdExecuteCommands(commandBuffer, 1, &secondaryBuffers[offscreenJob]);
 
-        vkCmdBindPipeline(commandBuffers[index], VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPass.pipeline);
-        
-        vkCmdBindVertexBuffers(commandBuffers[index], 0, 1, vertexBuffers, offsets);
+        vkCmdEndRenderPass(commandBuffer);
 
-        vkCmdBindIndexBuffer(commandBuffers[index], indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+        gpuProfiler.endScope(commandBuffer, scope);
+    });
 
-        vkCmdBindDescriptorSets(commandBuffers[index], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets, 0, nullptr);
+    renderGraph.read(offscreenPassId, vertexData, VERTEX_BUFFER_READ);
+    renderGraph.read(offscreenPassId, indexData, INDEX_BUFFER_READ);
+    renderGraph.read(offscreenPassId, uniformData, UNIFORM_BUFFER_READ);
+    renderGraph.write(offscreenPassId, offscreenColor, COLOR_ATTACHMENT_WRITE);
+    renderGraph.write(offscreenPassId, offscreenDepth, DEPTH_ATTACHMENT_WRITE);
 
-        vkCmdDrawIndexed(commandBuffers[index], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-
-        vkCmdEndRenderPass(commandBuffers[index]);
-    }
-
-    {
+    imguiPassId = renderGraph.addPass("imgui pass", [&](VkCommandBuffer commandBuffer) {
+        uint32_t scope = gpuProfiler.beginScope(commandBuffer, "imgui pass");
         VkRenderPassBeginInfo renderPassInfo{};
         VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
 
@@ -143,14 +227,88 @@ void VulkanApp::buildCommandBuffer(uint32_t index)
         renderPassInfo.clearValueCount = 1;
         renderPassInfo.pClearValues = &clearColor;
 
-        vkCmdBeginRenderPass(commandBuffers[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        vkCmdExecuteCommands(commandBuffer, 1, &secondaryBuffers[imguiJob]);
 
-        imgui.get()->drawFrame(commandBuffers[index]);
+        vkCmdEndRenderPass(commandBuffer);
 
-        vkCmdEndRenderPass(commandBuffers[index]);
+        gpuProfiler.endScope(commandBuffer, scope);
+    });
+
+    // a closed or collapsed "Render to texture" window culls the offscreen pass
+    if (offscreen.visible) {
+        renderGraph.read(imguiPassId, offscreenColor, FRAGMENT_SAMPLED_READ);
     }
 
-    if (vkEndCommandBuffer(commandBuffers[index]) != VK_SUCCESS) {
+    renderGraph.write(imguiPassId, backBuffer, ResourceUsage{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED});
+
+    renderGraph.compile();
+
+    // every live pass records into its own secondary buffer on a worker thread
+    if (!renderGraph.isCulled(offscreenPassId)) {
+        offscreenFrameBuffer = getOffscreenFramebuffer(offscreen.target, renderGraph.getImageView(offscreenDepth));
+
+        offscreenInheritance.renderPass = offscreenPass.renderPass;
+        offscreenInheritance.framebuffer = offscreenFrameBuffer;
+
+        offscreenJob = commandRecorder.record(offscreenInheritance, [this, &offscreen](VkCommandBuffer commandBuffer) {
+            VkViewport viewport = createViewport(static_cast<float>(offscreen.width), static_cast<float>(offscreen.height), 0.0f, 1.0f);
+            VkRect2D scissor = createRect2D(offscreen.width, offscreen.height, 0, 0);
+            VkBuffer vertexBuffers[] = {vertexBuffer};
+            VkDeviceSize offsets[] = {0};
+            uint32_t dynamicOffset = static_cast<uint32_t>(uniformOffset);
+
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPass.pipeline);
+
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets, 1, &dynamicOffset);
+
+            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        });
+    }
+    else {
+        // the graph drops the depth image of a culled pass
+        releaseOffscreenFramebuffer();
+    }
+
+    imguiInheritance.renderPass = renderPass;
+    imguiInheritance.framebuffer = swapChainFramebuffers[index];
+
+    imguiJob = commandRecorder.record(imguiInheritance, [this, drawData](VkCommandBuffer commandBuffer) {
+        imgui.get()->drawFrame(commandBuffer, drawData);
+    });
+
+    {
+        CpuZone zone("wait recording jobs");
+        secondaryBuffers = commandRecorder.wait();
+    }
+
+    primaryBuffer = frames[currentFrame].commandBuffer;
+
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr; // Optional
+
+    if (vkBeginCommandBuffer(primaryBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    gpuProfiler.beginFrame(static_cast<uint32_t>(currentFrame), primaryBuffer);
+    frameScope = gpuProfiler.beginScope(primaryBuffer, "frame");
+
+    renderGraph.execute(primaryBuffer);
+
+    gpuProfiler.endScope(primaryBuffer, frameScope);
+
+    if (vkEndCommandBuffer(primaryBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
 }
@@ -173,53 +331,324 @@ VkShaderModule VulkanApp::createShaderModule(const std::vector<char>& code)
     return shaderModule;
 }
 
-void VulkanApp::run()
+void VulkanApp::run(bool pipelined, uint32_t frameCount)
 {
-    myTextureId = ImGui_ImplVulkan_AddTexture(textureSampler, offscreenPass.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    maxFrames = frameCount;
+    framesRun = 0;
 
-    while (!glfwWindowShouldClose(pWindow.get())) {
-        glfwPollEvents();
-        drawFrame();
+    CpuProfiler::setThreadName("main");
+
+    // the UI thread moves the draw lists to the next frame's region while the render thread
+    // records the previous snapshot, which reads the current region unsynchronized
+    if (pipelined && ImGui_ImplVulkan_HasDirectGeometry()) {
+        throw std::runtime_error("direct ImGui geometry can't be used in pipelined runs!");
+    }
+
+    if (pipelined) {
+        runPipelined();
+    }
+    else {
+        while (keepRunning()) {
+            pollEvents();
+            drawFrame();
+        }
     }
 
     vkDeviceWaitIdle(device);
 }
 
+void VulkanApp::setUiScript(std::function<void(uint32_t frame)> script)
+{
+    uiScript = std::move(script);
+
+    // window positions must not depend on a previous run
+    ImGui::GetIO().IniFilename = nullptr;
+}
+
+void VulkanApp::setFrameCallback(std::function<void(const FrameTiming&)> callback)
+{
+    frameCallback = std::move(callback);
+}
+
+void VulkanApp::setDirectImguiGeometry(bool enable)
+{
+    directImguiGeometry = enable;
+}
+
+void VulkanApp::setBindlessImguiTextures(bool enable)
+{
+    bindlessImguiTextures = enable;
+}
+
+bool VulkanApp::keepRunning()
+{
+    if (maxFrames != 0 && framesRun++ >= maxFrames) {
+        return false;
+    }
+
+    return !windowShouldClose();
+}
+
 void VulkanApp::drawFrame()
 {
     uint32_t imageIndex = 0;
+    FrameTiming timing{};
+    uint64_t start = CpuProfiler::now();
+    uint64_t phaseStart = start;
+    // ms since phaseStart, then starts the next phase
+    auto endPhase = [&phaseStart]() {
+        uint64_t now = CpuProfiler::now();
+        double elapsed = (now - phaseStart) / 1e6;
+
+        phaseStart = now;
+
+        return elapsed;
+    };
+
+    timing.frame = uiFrame;
+
+    {
+        CpuZone frameZone("frame");
+
+        {
+            CpuZone zone("prepareFrame");
+
+            // no image was acquired, the swap chain has been recreated for the next frame
+            if (!prepareFrame(&imageIndex)) {
+                handleWindowResize();
+                timing.skipped = true;
+            }
+        }
+
+        // the frame still closes and reaches the frame callback, flagged as skipped
+        if (timing.skipped) {
+            timing.prepare = endPhase();
+        }
+        else {
+            uniformRing.beginFrame(currentFrame);
+            timing.prepare = endPhase();
+
+            {
+                CpuZone zone("drawImguiObjects");
+                drawImguiObjects();
+            }
+
+            timing.imgui = endPhase();
+
+            {
+                CpuZone zone("updateUniformBuffer");
+                updateUniformBuffer(buildUniformBufferObject());
+            }
+
+            timing.uniforms = endPhase();
+
+            updateTextures();
+
+            {
+                CpuZone zone("buildCommandBuffer");
+                buildCommandBuffer(imageIndex, ImGui::GetDrawData(), offscreenPass.view);
+            }
 
-    if (!prepareFrame(&imageIndex)) {
-        handleWindowResize();
+            timing.record = endPhase();
+
+            {
+                CpuZone zone("submitFrame");
+
+                if (!submitFrame(imageIndex)) {
+                    handleWindowResize();
+                }
+            }
+
+            timing.submit = endPhase();
+        }
+    }
+
+    CpuProfiler::endFrame();
+
+    timing.total = (CpuProfiler::now() - start) / 1e6;
+
+    if (frameCallback) {
+        frameCallback(timing);
     }
+}
+
+void VulkanApp::runPipelined()
+{
+    uint32_t writeIndex = 0;
+
+    // GLFW may only be used from the main thread, so the swap chain is recreated here
+    deferSwapChainRecreation = true;
+    stopRendering = false;
+    renderThread = std::thread(&VulkanApp::renderLoop, this);
+
+    try {
+        while (keepRunning()) {
+            {
+                CpuZone frameZone("frame");
+
+                pollEvents();
+
+                if (swapChainOutOfDate) {
+                    std::unique_lock<std::mutex> lock(snapshotMutex);
+
+                    waitForSnapshots(lock, [this] { return readySnapshot == -1 && renderingSnapshot == -1; });
+
+                    swapChainOutOfDate = false;
+                    recreateSwapChain();
+                    handleWindowResize();
+                }
+
+                {
+                    CpuZone zone("wait free snapshot");
+                    std::unique_lock<std::mutex> lock(snapshotMutex);
+
+                    waitForSnapshots(lock, [this, writeIndex] {
+                        return readySnapshot != static_cast<int>(writeIndex) && renderingSnapshot != static_cast<int>(writeIndex);
+                    });
+                }
+
+                // build frame N+1 while the render thread records and submits frame N
+                {
+                    CpuZone zone("drawImguiObjects");
+                    drawImguiObjects();
+                }
+
+                {
+                    CpuZone zone("capture snapshot");
+                    snapshots[writeIndex].drawData.capture(ImGui::GetDrawData());
+                    snapshots[writeIndex].ubo = buildUniformBufferObject();
+                    snapshots[writeIndex].offscreen = offscreenPass.view;
+                }
 
-    drawImguiObjects();
+                {
+                    CpuZone zone("publish snapshot");
+                    std::unique_lock<std::mutex> lock(snapshotMutex);
 
-    updateUniformBuffer();
+                    waitForSnapshots(lock, [this] { return readySnapshot == -1; });
 
-    buildCommandBuffer(imageIndex);
+                    readySnapshot = static_cast<int>(writeIndex);
+                }
 
-    if (!submitFrame(imageIndex)) {
-        handleWindowResize();
+                snapshotChanged.notify_all();
+                writeIndex ^= 1;
+            }
+
+            CpuProfiler::endFrame();
+        }
+    }
+    catch (...) {
+        stopRenderThread();
+        throw;
     }
+
+    stopRenderThread();
 }
 
-void VulkanApp::createVertexBuffer()
+void VulkanApp::waitForSnapshots(std::unique_lock<std::mutex>& lock, const std::function<bool()>& condition)
 {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-    void* data;
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    snapshotChanged.wait(lock, [this, &condition] { return renderThreadError || condition(); });
 
-    createBuffer(bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer,
-                 stagingBufferMemory);
+    if (renderThreadError) {
+        std::rethrow_exception(renderThreadError);
+    }
+}
+
+void VulkanApp::stopRenderThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        stopRendering = true;
+    }
+
+    snapshotChanged.notify_all();
+
+    if (renderThread.joinable()) {
+        renderThread.join();
+    }
+
+    deferSwapChainRecreation = false;
+}
+
+void VulkanApp::renderLoop()
+{
+    CpuProfiler::setThreadName("render");
+
+    try {
+        for (;;) {
+            int index = -1;
+
+            {
+                std::unique_lock<std::mutex> lock(snapshotMutex);
+
+                snapshotChanged.wait(lock, [this] { return stopRendering || readySnapshot != -1; });
+
+                if (readySnapshot == -1) {
+                    return;
+                }
+
+                index = readySnapshot;
+                renderingSnapshot = index;
+                readySnapshot = -1;
+            }
+
+            snapshotChanged.notify_all();
+
+            renderFrame(snapshots[index]);
+
+            {
+                std::lock_guard<std::mutex> lock(snapshotMutex);
+                renderingSnapshot = -1;
+            }
+
+            snapshotChanged.notify_all();
+        }
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            renderThreadError = std::current_exception();
+            renderingSnapshot = -1;
+        }
+
+        snapshotChanged.notify_all();
+    }
+}
+
+void VulkanApp::renderFrame(FrameSnapshot& snapshot)
+{
+    CpuZone frameZone("render frame");
+    uint32_t imageIndex = 0;
+
+    {
+        CpuZone zone("prepareFrame");
+
+        // the swap chain is out of date, drop frames until the main thread has recreated it
+        if (!prepareFrame(&imageIndex)) {
+            return;
+        }
+    }
 
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+    uniformRing.beginFrame(currentFrame);
+
+    updateUniformBuffer(snapshot.ubo);
+
+    updateTextures();
+
+    {
+        CpuZone zone("buildCommandBuffer");
+        buildCommandBuffer(imageIndex, snapshot.drawData.get(), snapshot.offscreen);
+    }
+
+    {
+        CpuZone zone("submitFrame");
+        submitFrame(imageIndex);
+    }
+}
+
+void VulkanApp::createVertexBuffer()
+{
+    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    StagingRegion staging = stageData(vertices.data(), bufferSize);
 
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
@@ -227,28 +656,13 @@ void VulkanApp::createVertexBuffer()
                  vertexBuffer,
                  vertexBufferMemory);
 
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    copyBuffer(staging.buffer, vertexBuffer, bufferSize, staging.offset);
 }
 
 void VulkanApp::createIndexBuffer()
 {
     VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    void* data;
-
-    createBuffer(bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer,
-                 stagingBufferMemory);
-
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+    StagingRegion staging = stageData(indices.data(), bufferSize);
 
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
@@ -256,10 +670,7 @@ void VulkanApp::createIndexBuffer()
                  indexBuffer,
                  indexBufferMemory);
 
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    copyBuffer(staging.buffer, indexBuffer, bufferSize, staging.offset);
 }
 
 void VulkanApp::createDescriptorSetLayout()
@@ -270,7 +681,7 @@ void VulkanApp::createDescriptorSetLayout()
     std::vector<VkDescriptorSetLayoutBinding> bindings;
 
     uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding.descriptorCount = 1;
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     uboLayoutBinding.pImmutableSamplers = nullptr;
@@ -293,33 +704,50 @@ void VulkanApp::createDescriptorSetLayout()
     }
 }
 
+// One persistently mapped buffer holding a region per frame in flight,
+// addressed through dynamic offsets of a single descriptor set
 void VulkanApp::createUniformBuffers()
 {
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+    VkDeviceSize bufferSize = UNIFORM_FRAME_BUDGET * MAX_FRAMES_IN_FLIGHT;
 
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                  uniformBuffers,
                  uniformBuffersMemory);
+
+    uniformRing.init(uniformBuffersMemory.mapped,
+                     UNIFORM_FRAME_BUDGET,
+                     MAX_FRAMES_IN_FLIGHT,
+                     deviceProperties.limits.minUniformBufferOffsetAlignment);
 }
 
-void VulkanApp::updateUniformBuffer()
+UniformBufferObject VulkanApp::buildUniformBufferObject()
 {
     static auto startTime = std::chrono::high_resolution_clock::now();
     auto currentTime = std::chrono::high_resolution_clock::now();
     float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-    void* data;
     UniformBufferObject ubo{};
 
+    // scripted runs advance at a fixed 60 frames per second
+    if (uiScript) {
+        time = uiFrame / 60.0f;
+    }
+
     ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     ubo.proj = glm::perspective(glm::radians(45.0f), textureWindowSize.x / textureWindowSize.y, 0.1f, 10.0f);
     ubo.proj[1][1] *= -1;
-    
-    vkMapMemory(device, uniformBuffersMemory, 0, sizeof(ubo), 0, &data);
+
+    return ubo;
+}
+
+void VulkanApp::updateUniformBuffer(const UniformBufferObject& ubo)
+{
+    void* data;
+
+    uniformOffset = uniformRing.allocate(sizeof(ubo), &data);
     memcpy(data, &ubo, sizeof(ubo));
-    vkUnmapMemory(device, uniformBuffersMemory);
 }
 
 void VulkanApp::createDescriptorPool()
@@ -327,15 +755,17 @@ void VulkanApp::createDescriptorPool()
     std::vector<VkDescriptorPoolSize> poolSizes{2};
     VkDescriptorPoolCreateInfo poolInfo{};
 
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = SCENE_DESCRIPTOR_SETS;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+    poolSizes[1].descriptorCount = SCENE_DESCRIPTOR_SETS;
 
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    // sets are replaced once their texture is resident
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
+    poolInfo.maxSets = SCENE_DESCRIPTOR_SETS;
 
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
@@ -343,18 +773,25 @@ void VulkanApp::createDescriptorPool()
 }
 
 void VulkanApp::createDescriptorSets()
+{
+    descriptorSets = createDescriptorSet();
+}
+
+// bound to the texture's current view, i.e. the placeholder until it is resident
+VkDescriptorSet VulkanApp::createDescriptorSet()
 {
     VkDescriptorSetAllocateInfo allocInfo{};
     VkDescriptorBufferInfo bufferInfo{};
     VkDescriptorImageInfo imageInfo{};
     std::vector<VkWriteDescriptorSet> descriptorWrites{2};
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
 
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts = &descriptorSetLayout;
 
-    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSets) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
@@ -363,19 +800,19 @@ void VulkanApp::createDescriptorSets()
     bufferInfo.range = sizeof(UniformBufferObject);
 
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = textureImageView;
+    imageInfo.imageView = textureLoader.getView(textureHandle);
     imageInfo.sampler = textureSampler;
     
     descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = descriptorSets;
+    descriptorWrites[0].dstSet = descriptorSet;
     descriptorWrites[0].dstBinding = 0;
     descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorWrites[0].descriptorCount = 1;
     descriptorWrites[0].pBufferInfo = &bufferInfo;
 
     descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = descriptorSets;
+    descriptorWrites[1].dstSet = descriptorSet;
     descriptorWrites[1].dstBinding = 1;
     descriptorWrites[1].dstArrayElement = 0;
     descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -383,51 +820,38 @@ void VulkanApp::createDescriptorSets()
     descriptorWrites[1].pImageInfo = &imageInfo;
 
     vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    return descriptorSet;
 }
 
 void VulkanApp::createTextureImage()
 {
-    int texWidth = 0, texHeight = 0, texChannels = 0;
-    stbi_uc* pixels = stbi_load("textures/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    void* data;
-
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture image!");
-    }
-
-    createBuffer(imageSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer,
-                 stagingBufferMemory);
+    // the cooked texture, when `make cook` has produced it, skips decoding and mip generation
+    bool cooked = std::ifstream(COOKED_TEXTURE_PATH).good();
 
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    stbi_image_free(pixels);
-
-    createImage(texWidth, texHeight,
-                VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                textureImage, textureImageMemory);
+    textureHandle = textureLoader.load(cooked ? COOKED_TEXTURE_PATH : TEXTURE_PATH);
+}
 
-    transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+void VulkanApp::updateTextures()
+{
+    textureAtlas.update();
 
-    copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+    for (auto handle : textureLoader.update()) {
+        // frames in flight still use the placeholder's set
+        if (handle == textureHandle) {
+            VkDescriptorSet retired = descriptorSets;
 
-    transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            descriptorSets = createDescriptorSet();
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-}
+            deletionQueue.push([this, retired]() {
+                vkFreeDescriptorSets(device, descriptorPool, 1, &retired);
+            });
+        }
+    }
 
-void VulkanApp::createTextureImageView()
-{
-    textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+    if (textureLoader.hasFailed(textureHandle)) {
+        throw std::runtime_error("failed to load texture image!");
+    }
 }
 
 void VulkanApp::createTextureSampler()
@@ -441,14 +865,14 @@ void VulkanApp::createTextureSampler()
     samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = 16.0f;
+    samplerInfo.maxAnisotropy = std::min(16.0f, deviceProperties.limits.maxSamplerAnisotropy);
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // views clamp to their own levels
 
     if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler!");
@@ -464,104 +888,286 @@ void VulkanApp::prepareImgui()
 {
     imgui = std::move(std::unique_ptr<MyImgui>(new MyImgui(this)));
 
+    if (bindlessImguiTextures && !descriptorIndexingSupported) {
+        std::cout << "no descriptor indexing, ImGui textures use a descriptor set each" << std::endl;
+        bindlessImguiTextures = false;
+    }
+
     imgui.get()->init();
-    imgui.get()->initVulkanResource(renderPass);
+    imgui.get()->initVulkanResource(renderPass, directImguiGeometry ? IMGUI_DIRECT_GEOMETRY_SIZE : 0,
+                                    bindlessImguiTextures ? IMGUI_BINDLESS_TEXTURE_COUNT : 0);
+
+    if (directImguiGeometry && !ImGui_ImplVulkan_HasDirectGeometry()) {
+        std::cout << "no device-local host-visible memory, ImGui geometry is copied" << std::endl;
+    }
 }
 
 void VulkanApp::prepareOffscreen()
 {
     createOffscreensRenderPass();
-    createOffscreenImage();
-    createOffscreenImageView();
-    createOffscreenFramebuffer();
+    offscreenPass.view.target = createOffscreenTarget(WIDTH, HEIGHT);
+    offscreenPass.view.target.generation = ++offscreenGeneration;
+    offscreenPass.view.width = WIDTH;
+    offscreenPass.view.height = HEIGHT;
     createOffscreenPipeline();
 }
 
 void VulkanApp::createOffscreensRenderPass()
 {
     VkAttachmentDescription colorAttachment{};
+    VkAttachmentDescription depthAttachment{};
+    std::array<VkAttachmentDescription, 2> attachments{};
     VkAttachmentReference colorAttachmentRef{};
+    VkAttachmentReference depthAttachmentRef{};
     VkSubpassDescription subpass{};
-    std::vector<VkSubpassDependency> dependencies{2};
     VkRenderPassCreateInfo renderPassInfo{};
 
+    // layout transitions and dependencies on other passes are barriers of the render graph
     colorAttachment.format = VK_FORMAT_R8G8B8A8_SRGB;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    depthAttachment.format = OFFSCREEN_DEPTH_FORMAT;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    attachments = {colorAttachment, depthAttachment};
 
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
-
-    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[0].dstSubpass = 0;
-    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-    dependencies[1].srcSubpass = 0;
-    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-    renderPassInfo.pDependencies = dependencies.data();
 
     if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &offscreenPass.renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
 }
 
-void VulkanApp::createOffscreenImage()
+OffscreenTarget VulkanApp::createOffscreenTarget(uint32_t width, uint32_t height)
 {
-    offscreenPass.width = WIDTH;
-    offscreenPass.height = HEIGHT;
+    OffscreenTarget target{};
 
-    createImage(WIDTH, HEIGHT,
+    target.width = width;
+    target.height = height;
+
+    createImage(width, height, 1,
                 VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                offscreenPass.color.image, offscreenPass.color.mem);
+                target.color.image, target.color.mem);
+
+    target.color.view = createImageView(target.color.image, VK_FORMAT_R8G8B8A8_SRGB, 1);
+
+    target.textureId = ImGui_ImplVulkan_AddTexture(textureSampler, target.color.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    return target;
+}
+
+void VulkanApp::destroyOffscreenTarget(OffscreenTarget& target)
+{
+    ImGui_ImplVulkan_RemoveTexture(target.textureId);
+    vkDestroyImageView(device, target.color.view, nullptr);
+    destroyImage(target.color.image, target.color.mem);
+}
+
+void VulkanApp::updateResolutionScale()
+{
+    float gpuFrameTime = 0.0f;
+
+    if (!dynamicResolution || !gpuProfiler.isSupported()) {
+        resolutionScale = 1.0f;
+        return;
+    }
+
+    if (++resolutionAdjustFrames < RESOLUTION_ADJUST_FRAMES) {
+        return;
+    }
+
+    resolutionAdjustFrames = 0;
+
+    for (auto& scope : gpuProfiler.getStats()) {
+        if (scope.name == "frame") {
+            gpuFrameTime = scope.last;
+        }
+    }
+
+    // drop quickly when over budget, recover slowly once there is headroom
+    if (gpuFrameTime > gpuFrameBudget) {
+        resolutionScale = std::max(resolutionScale * 0.9f, MIN_RESOLUTION_SCALE);
+    }
+    else if (gpuFrameTime < gpuFrameBudget * 0.75f) {
+        resolutionScale = std::min(resolutionScale + 0.02f, 1.0f);
+    }
+}
+
+// Runs on the thread building the UI before the frame's UI, so the frame's image and its
+// UV rect match what it records
+void VulkanApp::updateOffscreenTarget()
+{
+    OffscreenView& view = offscreenPass.view;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool grow = false;
+    std::vector<OffscreenTarget> surplus;
+
+    updateResolutionScale();
+
+    width = static_cast<uint32_t>(textureWindowSize.x * resolutionScale);
+    height = static_cast<uint32_t>(textureWindowSize.y * resolutionScale);
+    width = std::clamp(width, 1u, deviceProperties.limits.maxFramebufferWidth);
+    height = std::clamp(height, 1u, deviceProperties.limits.maxFramebufferHeight);
+
+    grow = width > view.target.width || height > view.target.height;
+
+    if (width * height < OFFSCREEN_SHRINK_AREA * view.target.width * view.target.height) {
+        shrinkFrames++;
+    }
+    else {
+        shrinkFrames = 0;
+    }
+
+    if (grow || shrinkFrames >= OFFSCREEN_SHRINK_FRAMES) {
+        replaceOffscreenTarget(width, height);
+        shrinkFrames = 0;
+    }
+
+    view.width = static_cast<int32_t>(width);
+    view.height = static_cast<int32_t>(height);
+
+    // the pool is refilled by the recording thread, descriptor sets are only freed on this one
+    {
+        std::lock_guard<std::mutex> lock(offscreenMutex);
+
+        while (offscreenPool.size() > OFFSCREEN_POOL_SIZE) {
+            surplus.push_back(offscreenPool.front());
+            offscreenPool.erase(offscreenPool.begin());
+        }
+    }
+
+    for (auto& target : surplus) {
+        destroyOffscreenTarget(target);
+    }
 }
 
-void VulkanApp::createOffscreenImageView()
+void VulkanApp::replaceOffscreenTarget(uint32_t width, uint32_t height)
 {
-    offscreenPass.color.view = createImageView(offscreenPass.color.image, VK_FORMAT_R8G8B8A8_SRGB);
+    OffscreenTarget target{};
+
+    {
+        std::lock_guard<std::mutex> lock(offscreenMutex);
+
+        for (auto it = offscreenPool.begin(); it != offscreenPool.end(); it++) {
+            if (it->width >= width && it->height >= height &&
+                width * height >= OFFSCREEN_SHRINK_AREA * it->width * it->height) {
+                target = *it;
+                offscreenPool.erase(it);
+                break;
+            }
+        }
+
+        replacedTargets.push_back(offscreenPass.view.target);
+    }
+
+    if (target.color.image == VK_NULL_HANDLE) {
+        auto roundUp = [](uint32_t size, uint32_t limit) {
+            return std::min((size + OFFSCREEN_SIZE_STEP - 1) / OFFSCREEN_SIZE_STEP * OFFSCREEN_SIZE_STEP, limit);
+        };
+
+        target = createOffscreenTarget(roundUp(width, deviceProperties.limits.maxFramebufferWidth),
+                                       roundUp(height, deviceProperties.limits.maxFramebufferHeight));
+    }
+
+    target.generation = ++offscreenGeneration;
+    offscreenPass.view.target = target;
+}
+
+// Runs on the recording thread, targets replaced before generation are used by frames
+// recorded up to now at most and retire with the frame being recorded
+void VulkanApp::retireReplacedTargets(uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(offscreenMutex);
+
+    for (auto it = replacedTargets.begin(); it != replacedTargets.end();) {
+        if (it->generation >= generation) {
+            it++;
+            continue;
+        }
+
+        deletionQueue.push([this, target = *it]() {
+            std::lock_guard<std::mutex> lock(offscreenMutex);
+            offscreenPool.push_back(target);
+        });
+
+        it = replacedTargets.erase(it);
+    }
 }
 
-void VulkanApp::createOffscreenFramebuffer()
+// Runs on the recording thread, the framebuffer is kept while the frames use the same target and
+// depth image. A new depth image is made while the old one still lives, so its view never matches
+// a released framebuffer's.
+VkFramebuffer VulkanApp::getOffscreenFramebuffer(const OffscreenTarget& target, VkImageView depth)
 {
-    std::vector<VkImageView> attachments;
     VkFramebufferCreateInfo fbufCreateInfo{};
+    std::array<VkImageView, 2> attachments = {target.color.view, depth};
+
+    if (offscreenFramebuffer.frameBuffer != VK_NULL_HANDLE &&
+        offscreenFramebuffer.generation == target.generation && offscreenFramebuffer.depth == depth) {
+        return offscreenFramebuffer.frameBuffer;
+    }
 
-    attachments.push_back(offscreenPass.color.view);
+    releaseOffscreenFramebuffer();
 
     fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
     fbufCreateInfo.renderPass = offscreenPass.renderPass;
-    fbufCreateInfo.attachmentCount = attachments.size();
+    fbufCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     fbufCreateInfo.pAttachments = attachments.data();
-    fbufCreateInfo.width = offscreenPass.width;
-    fbufCreateInfo.height = offscreenPass.height;
+    fbufCreateInfo.width = target.width;
+    fbufCreateInfo.height = target.height;
     fbufCreateInfo.layers = 1;
 
-    vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &offscreenPass.frameBuffer);
+    if (vkCreateFramebuffer(device, &fbufCreateInfo, nullptr, &offscreenFramebuffer.frameBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create offscreen framebuffer!");
+    }
+
+    offscreenFramebuffer.generation = target.generation;
+    offscreenFramebuffer.depth = depth;
+
+    return offscreenFramebuffer.frameBuffer;
+}
+
+// the framebuffer retires with the frame being recorded
+void VulkanApp::releaseOffscreenFramebuffer()
+{
+    if (offscreenFramebuffer.frameBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    deletionQueue.push([this, frameBuffer = offscreenFramebuffer.frameBuffer]() {
+        vkDestroyFramebuffer(device, frameBuffer, nullptr);
+    });
+
+    offscreenFramebuffer = OffscreenFramebuffer{};
 }
 
 void VulkanApp::createOffscreenPipeline()
@@ -578,6 +1184,7 @@ void VulkanApp::createOffscreenPipeline()
     VkPipelineViewportStateCreateInfo viewportState{};
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     VkPipelineMultisampleStateCreateInfo multisampling{};
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
@@ -639,6 +1246,13 @@ void VulkanApp::createOffscreenPipeline()
     multisampling.pSampleMask = nullptr;            // Optional
     multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
     multisampling.alphaToOneEnable = VK_FALSE;      // Optional
+
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
  
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     colorBlendAttachment.blendEnable = VK_TRUE;
@@ -682,7 +1296,7 @@ void VulkanApp::createOffscreenPipeline()
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &pipelineDynamicStateCreateInfo; // Optional
     pipelineInfo.layout = pipelineLayout;
@@ -691,7 +1305,7 @@ void VulkanApp::createOffscreenPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex = -1;              // Optional
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &offscreenPass.pipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &offscreenPass.pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
@@ -701,17 +1315,163 @@ void VulkanApp::createOffscreenPipeline()
 
 void VulkanApp::drawImguiObjects()
 {
+    updateOffscreenTarget();
+    // ImGui textures are added and removed on this thread only
+    textureAtlas.newFrame();
+
     imgui.get()->newFrame();
     if (show_demo_window) {
         ImGui::ShowDemoWindow(&show_demo_window);
     }
 
+    offscreenPass.view.visible = false;
+
     if (show_another_window) {
-        ImGui::Begin("Render to texture", &show_another_window); // Pass a pointer to our bool variable (the window will have a closing button that will clear the bool when clicked)
-        textureWindowSize = ImGui::GetWindowSize();
-        ImGui::Image(myTextureId, textureWindowSize);
+        const OffscreenView& view = offscreenPass.view;
+        ImVec2 displaySize{};
+
+        offscreenPass.view.visible = ImGui::Begin("Render to texture", &show_another_window); // Pass a pointer to our bool variable (the window will have a closing button that will clear the bool when clicked)
+        displaySize = ImGui::GetContentRegionAvail();
+
+        // a collapsed or squashed window keeps the last size
+        if (displaySize.x >= 1.0f && displaySize.y >= 1.0f) {
+            textureWindowSize = displaySize;
+        }
+
+        // the frame renders to the top left view.width x view.height texels of the target, the rect is inset
+        // by half a texel so bilinear filtering never blends in the undefined texels outside the render area
+        // (or, as the sampler repeats, those of the opposite edge)
+        ImGui::Image(view.target.textureId, textureWindowSize,
+                     ImVec2(0.5f / view.target.width, 0.5f / view.target.height),
+                     ImVec2((view.width - 0.5f) / view.target.width, (view.height - 0.5f) / view.target.height));
+        ImGui::End();
+    }
+
+    if (uiScript) {
+        uiScript(uiFrame++);
+        imgui.get()->endNewFrame();
+
+        return;
+    }
+
+    uiFrame++;
+
+    if (show_memory_window) {
+        MemoryStats stats = memoryAllocator.getStats();
+
+        ImGui::Begin("Device memory", &show_memory_window);
+        ImGui::Text("blocks: %u (%.2f MiB)", stats.blockCount, stats.blockBytes / (1024.0 * 1024.0));
+        ImGui::Text("allocations: %u (%.2f MiB used)", stats.allocationCount, stats.usedBytes / (1024.0 * 1024.0));
+        ImGui::Text("free ranges: %u (largest %.2f MiB)", stats.freeRangeCount, stats.largestFreeRange / (1024.0 * 1024.0));
+        ImGui::Text("vkAllocateMemory calls: %llu", static_cast<unsigned long long>(stats.deviceAllocations));
+        ImGui::Text("pending destruction: %zu", deletionQueue.size());
+        ImGui::Separator();
+        ImGui::Text("startup: %.1f ms (pipeline cache %s)", startupTime, pipelineCacheLoadedSize ? "warm" : "cold");
+        ImGui::End();
+    }
+
+    if (show_gpu_profiler_window) {
+        std::vector<GpuScopeStats> gpuStats = gpuProfiler.getStats();
+
+        ImGui::Begin("GPU profiler", &show_gpu_profiler_window);
+
+        if (!gpuProfiler.isSupported()) {
+            ImGui::Text("timestamps are not supported on the graphics queue");
+        }
+
+        ImGui::Text("last %u frames, ms (last / min / avg / max)", GPU_PROFILER_HISTORY);
+
+        for (auto& scope : gpuStats) {
+            ImGui::Text("%-16s %6.3f / %6.3f / %6.3f / %6.3f", scope.name.c_str(), scope.last, scope.min, scope.avg, scope.max);
+        }
+
+        ImGui::Separator();
+        ImGui::Checkbox("dynamic resolution", &dynamicResolution);
+        ImGui::SliderFloat("frame budget, ms", &gpuFrameBudget, 1.0f, 50.0f);
+        ImGui::Text("render to texture: %d x %d (scale %.2f), target %u x %u", offscreenPass.view.width, offscreenPass.view.height,
+                    resolutionScale, offscreenPass.view.target.width, offscreenPass.view.target.height);
+
+        ImGui::End();
+    }
+
+    if (show_cpu_profiler_window) {
+        std::string lastTrace = CpuProfiler::getLastTrace();
+
+        ImGui::Begin("CPU profiler", &show_cpu_profiler_window);
+        ImGui::InputInt("frames", &traceFrameCount);
+        traceFrameCount = std::max(traceFrameCount, 1);
+
+        if (CpuProfiler::isCapturePending()) {
+            ImGui::Text("capturing...");
+        }
+        else if (ImGui::Button("Capture Chrome trace")) {
+            CpuProfiler::requestCapture(static_cast<uint32_t>(traceFrameCount), CPU_TRACE_FILE);
+        }
+
+        if (!lastTrace.empty()) {
+            ImGui::Text("last trace: %s", lastTrace.c_str());
+        }
+
+        ImGui::End();
+    }
+
+    if (show_atlas_window) {
+        AtlasStats stats = textureAtlas.getStats();
+        int columns = 0;
+        int rows = 0;
+
+        ImGui::Begin("Texture atlas", &show_atlas_window);
+        ImGui::Text("pages: %u of %u (%u x %u)", stats.pages, ATLAS_MAX_PAGES, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+        ImGui::Text("images: %zu, pending: %zu", stats.images, stats.pending);
+        ImGui::Text("evicted pages: %llu", static_cast<unsigned long long>(stats.evictedPages));
+        ImGui::Separator();
+
+        ImGui::BeginChild("icons");
+        columns = std::max(1, static_cast<int>(ImGui::GetContentRegionAvail().x / (ATLAS_DEMO_ICON_SIZE + ImGui::GetStyle().ItemSpacing.x)));
+        rows = (static_cast<int>(ATLAS_DEMO_ICONS) + columns - 1) / columns;
+
+        // only the visible rows are looked up, so scrolling decides which pages stay
+        ImGuiListClipper clipper;
+        clipper.Begin(rows, ATLAS_DEMO_ICON_SIZE + ImGui::GetStyle().ItemSpacing.y);
+
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                for (int column = 0; column < columns && row * columns + column < static_cast<int>(ATLAS_DEMO_ICONS); column++) {
+                    if (column > 0) {
+                        ImGui::SameLine();
+                    }
+
+                    drawAtlasIcon(static_cast<uint32_t>(row * columns + column));
+                }
+            }
+        }
+
+        ImGui::EndChild();
         ImGui::End();
     }
 
     imgui.get()->endNewFrame();
-}
\ No newline at end of file
+}
+
+void VulkanApp::drawAtlasIcon(uint32_t index)
+{
+    std::string key = "icon" + std::to_string(index);
+    ImVec2 size(ATLAS_DEMO_ICON_SIZE, ATLAS_DEMO_ICON_SIZE);
+    AtlasEntry entry{};
+
+    uint32_t side = 0;
+    std::vector<uint8_t> pixels;
+
+    if (textureAtlas.lookup(key, entry)) {
+        ImGui::Image(entry.textureId, size, entry.uv0, entry.uv1);
+        return;
+    }
+
+    // pending or uploading icons are only generated once
+    if (!textureAtlas.contains(key)) {
+        pixels = generateIcon(index, side);
+        textureAtlas.insert(key, pixels.data(), side, side);
+    }
+
+    ImGui::Dummy(size);
+}
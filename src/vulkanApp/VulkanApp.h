@@ -1,19 +1,60 @@
 #ifndef _VULKAN_APP_H_
 #define _VULKAN_APP_H_
 
+#include "DrawDataSnapshot.h"
+#include "FrameRingBuffer.h"
+#include "MipChain.h"
 #include "MyImgui.h"
+#include "RenderGraph.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
 #include "VulkanBase.h"
 
 #include <array>
+#include <condition_variable>
 #include <cstdlib>
+#include <exception>
+#include <functional>
 #include <glm/glm.hpp>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <thread>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 constexpr int32_t WIDTH = 512;
 constexpr int32_t HEIGHT = 512;
+// per frame uniform data budget, a multiple of any minUniformBufferOffsetAlignment (at most 256)
+constexpr VkDeviceSize UNIFORM_FRAME_BUDGET = 64 * 1024;
+// scene descriptor sets alive at once, the current one and the one it replaced when the texture
+// became resident, which frames in flight still use
+constexpr uint32_t SCENE_DESCRIPTOR_SETS = 2;
+const std::string CPU_TRACE_FILE = "cpu_trace.json";
+const std::string TEXTURE_PATH = "textures/texture.jpg";
+const std::string COOKED_TEXTURE_PATH = "textures/texture.ctex";
+// offscreen targets are allocated in steps of this many pixels, so small resizes keep the target
+constexpr uint32_t OFFSCREEN_SIZE_STEP = 64;
+// a smaller target replaces the current one only once the rendered area has stayed
+// below this share of it for OFFSCREEN_SHRINK_FRAMES frames
+constexpr float OFFSCREEN_SHRINK_AREA = 0.25f;
+constexpr uint32_t OFFSCREEN_SHRINK_FRAMES = 60;
+// retired targets kept around for reuse
+constexpr size_t OFFSCREEN_POOL_SIZE = 2;
+// depth attachment of the offscreen pass, every device supports it
+constexpr VkFormat OFFSCREEN_DEPTH_FORMAT = VK_FORMAT_D16_UNORM;
+// dynamic resolution never renders below this share of the displayed size
+constexpr float MIN_RESOLUTION_SCALE = 0.5f;
+// frames between two resolution scale adjustments, GPU times lag the CPU by the frames in flight
+constexpr uint32_t RESOLUTION_ADJUST_FRAMES = 10;
+// per frame device-local, host-visible memory ImGui's draw lists write into when direct geometry is on
+constexpr VkDeviceSize IMGUI_DIRECT_GEOMETRY_SIZE = 4 * 1024 * 1024;
+// slots of ImGui's bindless texture array, far below the update-after-bind limits of any descriptor indexing device
+constexpr uint32_t IMGUI_BINDLESS_TEXTURE_COUNT = 4096;
+// generated icons of the texture atlas window, more than its pages hold so scrolling evicts
+constexpr uint32_t ATLAS_DEMO_ICONS = 8192;
+// displayed side of an atlas window icon, pixels
+constexpr float ATLAS_DEMO_ICON_SIZE = 32.0f;
 
 struct UniformBufferObject {
     glm::mat4 model;
@@ -60,16 +101,56 @@ struct Vertex {
     }
 };
 
+// CPU time of the drawFrame phases, ms
+struct FrameTiming {
+    uint32_t frame = 0;
+    double prepare = 0.0;
+    double imgui = 0.0;
+    double uniforms = 0.0;
+    double record = 0.0;
+    double submit = 0.0;
+    double total = 0.0;
+    bool skipped = false; // no swap chain image was acquired, only prepare ran
+};
+
 struct FrameBufferAttachment {
     VkImage image;
-    VkDeviceMemory mem;
+    Allocation mem;
     VkImageView view;
 };
 
+// A color target of the offscreen pass, frames render to its top left corner at any extent up to width x height
+struct OffscreenTarget {
+    uint32_t width = 0, height = 0;
+    FrameBufferAttachment color{};
+    ImTextureID textureId = nullptr;
+    uint64_t generation = 0; // increases every time a target becomes the current one
+};
+
+// The target one frame renders to and the extent it renders at
+struct OffscreenView {
+    OffscreenTarget target;
+    int32_t width = 0, height = 0;
+    bool visible = true; // drawn by the UI, the offscreen pass is culled otherwise
+};
+
+// The framebuffer of the offscreen pass, made on the recording thread as its depth attachment
+// is a transient image of the render graph
+struct OffscreenFramebuffer {
+    VkFramebuffer frameBuffer = VK_NULL_HANDLE;
+    uint64_t generation = 0; // of the color target
+    VkImageView depth = VK_NULL_HANDLE;
+};
+
+// Everything the render thread needs to record one frame in pipelined mode
+struct FrameSnapshot {
+    DrawDataSnapshot drawData;
+    UniformBufferObject ubo;
+    OffscreenView offscreen;
+};
+
 struct OffscreenPass {
-    int32_t width, height;
-    VkFramebuffer frameBuffer;
-    FrameBufferAttachment color, depth;
+    OffscreenView view; // current, only touched by the thread building the UI
     VkRenderPass renderPass;
     VkSampler sampler;
     VkDescriptorImageInfo descriptor;
@@ -89,59 +170,125 @@ public:
     VulkanApp(uint32_t width,
               uint32_t height,
               const std::string title,
-              bool enableValidationLayers) :
-        VulkanBase(width, height, title, enableValidationLayers) {}
+              bool enableValidationLayers,
+              bool headless = false) :
+        VulkanBase(width, height, title, enableValidationLayers, headless) {}
     ~VulkanApp();
-    void run();
+    // pipelined runs the UI on this thread and records/submits on a render thread,
+    // a non zero frameCount stops after that many frames
+    void run(bool pipelined = false, uint32_t frameCount = 0);
     void prepare();
-
+    // replaces the stats windows with caller drawn content and derives time from the
+    // frame number, so every run records the same frames, call after prepare()
+    void setUiScript(std::function<void(uint32_t frame)> script);
+    // called after every frame drawn on this thread, i.e. not in pipelined mode, skipped ones included
+    void setFrameCallback(std::function<void(const FrameTiming&)> callback);
+    // ImGui draw lists write their geometry straight into device memory (ReBAR) instead of being
+    // copied at record time, call before prepare(). Not for pipelined runs, run() throws.
+    void setDirectImguiGeometry(bool enable);
+    // every ImGui texture lives in one update-after-bind descriptor array and draws push their index,
+    // needs descriptor indexing, call before prepare()
+    void setBindlessImguiTextures(bool enable);
 
 private:
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    Allocation vertexBufferMemory;
     VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    Allocation indexBufferMemory;
     VkBuffer uniformBuffers;
-    VkDeviceMemory uniformBuffersMemory;
+    Allocation uniformBuffersMemory;
+    FrameRingBuffer uniformRing;
+    VkDeviceSize uniformOffset = 0;
     VkDescriptorPool descriptorPool;
     VkDescriptorSet descriptorSets;
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
+    TextureLoader textureLoader;
+    TextureHandle textureHandle = 0;
     VkSampler textureSampler;
+    TextureAtlas textureAtlas;
     std::unique_ptr<MyImgui> imgui;
-    ImTextureID myTextureId;
     struct OffscreenPass offscreenPass;
+    RenderGraph renderGraph; // only used by the recording thread
+    OffscreenFramebuffer offscreenFramebuffer; // only used by the recording thread
+    bool directImguiGeometry = false;
+    bool bindlessImguiTextures = false;
     bool show_demo_window = true;
     bool show_another_window = true;
-    ImVec2 textureWindowSize;
+    bool show_memory_window = true;
+    bool show_gpu_profiler_window = true;
+    bool show_cpu_profiler_window = true;
+    bool show_atlas_window = true;
+    int traceFrameCount = 60;
+    ImVec2 textureWindowSize = ImVec2(static_cast<float>(WIDTH), static_cast<float>(HEIGHT)); // displayed size of the offscreen image
+    bool dynamicResolution = true;
+    float gpuFrameBudget = 16.0f; // ms, dynamic resolution keeps the GPU frame time below it
+    float resolutionScale = 1.0f;
+    uint32_t resolutionAdjustFrames = 0;
+    uint32_t shrinkFrames = 0;
+    uint64_t offscreenGeneration = 0;
+    // replaced targets wait here until a frame using a newer one is recorded, retired ones
+    // return to the pool, both are shared between the UI and the recording thread
+    std::mutex offscreenMutex;
+    std::vector<OffscreenTarget> replacedTargets;
+    std::vector<OffscreenTarget> offscreenPool;
+    float startupTime = 0.0f; // ms spent in prepare()
+    uint32_t maxFrames = 0;
+    uint32_t framesRun = 0;
+    uint32_t uiFrame = 0;
+    std::function<void(uint32_t)> uiScript;
+    std::function<void(const FrameTiming&)> frameCallback;
+
+    // pipelined mode, the main thread fills one snapshot while the render thread records the other
+    std::array<FrameSnapshot, 2> snapshots;
+    int readySnapshot = -1;
+    int renderingSnapshot = -1;
+    bool stopRendering = false;
+    std::exception_ptr renderThreadError;
+    std::thread renderThread;
+    std::mutex snapshotMutex;
+    std::condition_variable snapshotChanged;
 
     VkShaderModule createShaderModule(const std::vector<char>& code);
+    bool keepRunning();
     void drawFrame();
+    void runPipelined();
+    void renderLoop();
+    void renderFrame(FrameSnapshot& snapshot);
+    void waitForSnapshots(std::unique_lock<std::mutex>& lock, const std::function<bool()>& condition);
+    void stopRenderThread();
     void createVertexBuffer();
     void createIndexBuffer();
     void createDescriptorSetLayout();
     void createUniformBuffers();
-    void updateUniformBuffer();
+    UniformBufferObject buildUniformBufferObject();
+    void updateUniformBuffer(const UniformBufferObject& ubo);
     void createDescriptorSets();
+    VkDescriptorSet createDescriptorSet();
     void createTextureImage();
-    void createTextureImageView();
+    // picks up textures that became resident, on the thread submitting frames
+    void updateTextures();
     void createTextureSampler();
     void createDescriptorPool();
     void handleWindowResize();
     void prepareImgui();
-    void buildCommandBuffer(uint32_t index);
+    void buildCommandBuffer(uint32_t index, ImDrawData* drawData, const OffscreenView& offscreen);
     void drawImguiObjects();
+    // one icon of the texture atlas window, inserted into the atlas when it isn't resident
+    void drawAtlasIcon(uint32_t index);
 
     // offsscreen
     void prepareOffscreen();
     void createOffscreensRenderPass();
-    void createOffscreenImage();
-    void createOffscreenImageView();
-    void createOffscreenFramebuffer();
+    OffscreenTarget createOffscreenTarget(uint32_t width, uint32_t height);
+    void destroyOffscreenTarget(OffscreenTarget& target);
+    void updateResolutionScale();
+    void updateOffscreenTarget();
+    void replaceOffscreenTarget(uint32_t width, uint32_t height);
+    void retireReplacedTargets(uint64_t generation);
+    VkFramebuffer getOffscreenFramebuffer(const OffscreenTarget& target, VkImageView depth);
+    void releaseOffscreenFramebuffer();
     void createOffscreenPipeline();
 };
 
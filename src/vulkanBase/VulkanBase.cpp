@@ -2,7 +2,9 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <stdexcept>
@@ -37,37 +39,71 @@ static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
     app->framebufferResized = true;
 }
 
-VulkanBase::VulkanBase(uint32_t width, uint32_t height, const std::string title, bool enableValidationLayers)
+VulkanBase::VulkanBase(uint32_t width, uint32_t height, const std::string title, bool enableValidationLayers, bool headless)
 {
     this->enableValidationLayers = enableValidationLayers;
+    this->headless = headless;
 
-    initWindow(width, height, title);
+    if (headless) {
+        headlessExtent = {width, height};
+    }
+    else {
+        initWindow(width, height, title);
+    }
 }
 
 VulkanBase::~VulkanBase()
 {
+    // retired swap chains and the like go before what they were created from, uploads run
+    // on a timeline of their own and may still write to something queued for deletion
+    frameTimeline.wait(frameTimeline.submittedValue());
+    uploadQueue.wait(uploadQueue.submit());
+    deletionQueue.flush();
+
     for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
         vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
     }
 
-    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
     vkDestroyRenderPass(device, renderPass, nullptr);
 
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
         vkDestroyImageView(device, swapChainImageViews[i], nullptr);
     }
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    if (headless) {
+        for (size_t i = 0; i < swapChainImages.size(); i++) {
+            destroyImage(swapChainImages[i], headlessImageMemory[i]);
+        }
+    }
+    else {
+        vkDestroySwapchainKHR(device, swapChain, nullptr);
+    }
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device, inFlightFences[i], nullptr);
+    }
+
+    commandRecorder.cleanup();
+
+    gpuProfiler.cleanup();
+
+    uploadQueue.cleanup();
+    frameTimeline.cleanup();
+
+    savePipelineCache();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+
+    destroyBuffer(stagingRingBuffer, stagingRingMemory);
+
+    for (auto& frame : frames) {
+        vkDestroyCommandPool(device, frame.commandPool, nullptr);
     }
 
     vkDestroyCommandPool(device, commandPool, nullptr);
 
+    memoryAllocator.cleanup();
+
     vkDestroyDevice(device, nullptr);
 
     if (enableValidationLayers) {
@@ -81,22 +117,15 @@ VulkanBase::~VulkanBase()
 void VulkanBase::createSyncObjects()
 {
     VkSemaphoreCreateInfo semaphoreInfo{};
-    VkFenceCreateInfo fenceInfo{};
 
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
 
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
 
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
@@ -107,11 +136,42 @@ bool VulkanBase::prepareFrame(uint32_t* ImageIndex)
 {
     VkResult result = VK_SUCCESS;
 
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    // values complete in order, so this also retires every older frame
+    {
+        CpuZone zone("wait frame timeline");
+        frameTimeline.wait(frames[currentFrame].timelineValue);
+    }
+
+    deletionQueue.collect(frameTimeline.completedValue());
+
+    uploadQueue.retire();
+    stagingRing.release(uploadQueue.getCompletedTicket());
+    commandRecorder.beginFrame(static_cast<uint32_t>(currentFrame));
+
+    // the frame's previous command buffer has completed, recycle all of its memory at once
+    vkResetCommandPool(device, frames[currentFrame].commandPool, 0);
+
+    if (headless) {
+        // nothing to acquire, the image was last used HEADLESS_IMAGE_COUNT frames ago which has retired by now
+        *ImageIndex = nextHeadlessImage;
+        nextHeadlessImage = (nextHeadlessImage + 1) % swapChainImageCount;
+    }
+    else {
+        CpuZone zone("vkAcquireNextImageKHR");
+        result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, ImageIndex);
+    }
 
-    result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, ImageIndex);
+    if (deferSwapChainRecreation && (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)) {
+        swapChainOutOfDate = true;
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        // a suboptimal image can still be rendered and presented
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            return false;
+        }
+    }
+    // a suboptimal image was acquired and its semaphore signalled, so it is still rendered
+    // and presented, present reports it again and recreates the swap chain then
+    else if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
         return false;
     }
@@ -119,14 +179,8 @@ bool VulkanBase::prepareFrame(uint32_t* ImageIndex)
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
-    // Check if a previous frame is using this image (i.e. there is its fence to wait on)
-    if (imagesInFlight[*ImageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device, 1, &imagesInFlight[*ImageIndex], VK_TRUE, UINT64_MAX);
-    }
-
-    // Mark the image as now being in use by this frame
-    imagesInFlight[*ImageIndex] = inFlightFences[currentFrame];
-
+    // no per image wait, rendering to an acquired image is ordered by imageAvailableSemaphores
+    // and all per frame resources were retired by the timeline wait above
     return true;
 }
 
@@ -137,27 +191,49 @@ bool VulkanBase::submitFrame(uint32_t imageIndex)
     VkSubmitInfo submitInfo{};
     std::vector<VkSemaphore> waitSemaphores;
     std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues;
     std::vector<VkSemaphore> signalSemaphores;
     std::vector<VkSwapchainKHR> swapChains;
 
-    waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
-    waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
-    signalSemaphores.push_back(renderFinishedSemaphores[currentFrame]);
-    swapChains.push_back(swapChain);
+    // headless frames have no acquire to wait for and no present to signal
+    if (!headless) {
+        waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        waitValues.push_back(0);
+        signalSemaphores.push_back(renderFinishedSemaphores[currentFrame]);
+        swapChains.push_back(swapChain);
+    }
+
+    // everything recorded for upload this frame goes out as one batch, the frame doesn't wait for it
+    {
+        CpuZone zone("submit uploads");
+        uploadQueue.submit();
+    }
+
+    frames[currentFrame].timelineValue = frameTimeline.reserve();
+    deletionQueue.stamp(frames[currentFrame].timelineValue);
+
+    // only the uploads already seen complete, the ones this frame may have used
+    uploadQueue.addFrameWaits(frames[currentFrame].timelineValue, waitSemaphores, waitStages, waitValues);
 
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.waitSemaphoreCount = waitSemaphores.size();
     submitInfo.pWaitSemaphores = waitSemaphores.data();
     submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &frames[currentFrame].commandBuffer;
     submitInfo.signalSemaphoreCount = signalSemaphores.size();
     submitInfo.pSignalSemaphores = signalSemaphores.data();
 
-    vkResetFences(device, 1, &inFlightFences[currentFrame]);
+    {
+        CpuZone zone("vkQueueSubmit");
+        frameTimeline.submit(graphicsQueue, submitInfo, frames[currentFrame].timelineValue, waitValues.data());
+    }
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    if (headless) {
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+        return true;
     }
 
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -167,24 +243,48 @@ bool VulkanBase::submitFrame(uint32_t imageIndex)
     presentInfo.pSwapchains = swapChains.data();
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr; // Optional
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+
+    {
+        CpuZone zone("vkQueuePresentKHR");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
+
+    // the frame was submitted either way, the next one must not wait for it
+    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR ||
         result == VK_SUBOPTIMAL_KHR ||
         framebufferResized) {
         framebufferResized = false;
-        recreateSwapChain();
+
+        if (deferSwapChainRecreation) {
+            swapChainOutOfDate = true;
+        }
+        else {
+            recreateSwapChain();
+        }
+
         return false;
     }
     else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
     return true;
 }
 
+bool VulkanBase::windowShouldClose()
+{
+    return !headless && glfwWindowShouldClose(pWindow.get());
+}
+
+void VulkanBase::pollEvents()
+{
+    if (!headless) {
+        glfwPollEvents();
+    }
+}
+
 void VulkanBase::initWindow(uint32_t width, uint32_t height, const std::string title)
 {
     glfwInit();
@@ -205,16 +305,37 @@ void VulkanBase::initVulkan()
 {
     createInstance();
     setupDebugMessenger();
-    createSurface();
+
+    if (!headless) {
+        createSurface();
+    }
+
     pickPhysicalDevice();
     createLogicalDevice();
-    createSwapChain();
+    memoryAllocator.init(device, memProperties, deviceProperties.limits.bufferImageGranularity);
+    frameTimeline.init(device, timelineSemaphoreSupported);
+    uploadQueue.init(device, transferQueue, deviceQueueFamilies.transferFamily.value_or(deviceQueueFamilies.graphicsFamily.value()), timelineSemaphoreSupported, &frameTimeline);
+    createStagingRing();
+    createPipelineCache();
+
+    if (headless) {
+        createHeadlessImages();
+    }
+    else {
+        createSwapChain();
+    }
+
     createImageViews();
     createRenderPass();
     createFramebuffers();
     createCommandPool();
-    createCommandBuffers();
+    createFrameContexts();
     createSyncObjects();
+    gpuProfiler.init(physicalDevice, device, deviceQueueFamilies.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT);
+    commandRecorder.init(device,
+                         deviceQueueFamilies.graphicsFamily.value(),
+                         std::clamp(std::thread::hardware_concurrency(), 1u, MAX_RECORD_THREADS),
+                         MAX_FRAMES_IN_FLIGHT);
 }
 
 void VulkanBase::createInstance()
@@ -296,15 +417,31 @@ std::vector<const char*> VulkanBase::getRequiredExtensions()
     uint32_t glfwExtensionCount = 0;
     const char** glfwExtensions;
     std::vector<const char*> extensions;
+    uint32_t availableCount = 0;
+    std::vector<VkExtensionProperties> availableExtensions;
 
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    if (!headless) {
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+
+    availableExtensions.resize(availableCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            physicalDeviceProperties2 = true;
+        }
+    }
+
     return extensions;
 }
 
@@ -370,6 +507,10 @@ void VulkanBase::pickPhysicalDevice()
     if (physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+
+    // queried once, memory types and limits don't change for the device's lifetime
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
 }
 
 bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device)
@@ -384,7 +525,10 @@ bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device)
 
     extensionsSupported = checkDeviceExtensionSupport(device);
 
-    if (extensionsSupported) {
+    if (headless) {
+        swapChainAdequate = true;
+    }
+    else if (extensionsSupported) {
         swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -403,6 +547,11 @@ bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device)
     std::vector<VkExtensionProperties> availableExtensions;
     std::set<std::string> requiredExtensions;
 
+    // the swap chain is the only required extension
+    if (headless) {
+        return true;
+    }
+
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
     availableExtensions.resize(extensionCount);
@@ -417,6 +566,89 @@ bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool VulkanBase::checkTimelineSemaphoreSupport(VkPhysicalDevice device)
+{
+    uint32_t extensionCount = 0;
+    std::vector<VkExtensionProperties> availableExtensions;
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+    VkPhysicalDeviceFeatures2 features{};
+    PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = nullptr;
+    bool extensionSupported = false;
+
+    if (!physicalDeviceProperties2) {
+        return false;
+    }
+
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    availableExtensions.resize(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) {
+            extensionSupported = true;
+        }
+    }
+
+    getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+
+    if (!extensionSupported || getFeatures2 == nullptr) {
+        return false;
+    }
+
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &timelineFeatures;
+    getFeatures2(device, &features);
+
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+bool VulkanBase::checkDescriptorIndexingSupport(VkPhysicalDevice device)
+{
+    uint32_t extensionCount = 0;
+    std::vector<VkExtensionProperties> availableExtensions;
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    VkPhysicalDeviceFeatures2 features{};
+    PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = nullptr;
+    bool indexingExtension = false;
+    bool maintenance3Extension = false;
+
+    if (!physicalDeviceProperties2) {
+        return false;
+    }
+
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    availableExtensions.resize(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0) {
+            indexingExtension = true;
+        }
+        else if (strcmp(extension.extensionName, VK_KHR_MAINTENANCE3_EXTENSION_NAME) == 0) {
+            maintenance3Extension = true;
+        }
+    }
+
+    getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+
+    if (!indexingExtension || !maintenance3Extension || getFeatures2 == nullptr) {
+        return false;
+    }
+
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &indexingFeatures;
+    getFeatures2(device, &features);
+
+    return features.features.shaderSampledImageArrayDynamicIndexing == VK_TRUE &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+           indexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+           indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE;
+}
+
 QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device)
 {
     QueueFamilyIndices indices{};
@@ -433,18 +665,29 @@ QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device)
     for (const auto& queueFamily : queueFamilies) {
         presentSupport = false;
 
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (!indices.isComplete()) {
+            // headless frames are never presented, the graphics queue stands in for the present queue
+            if (headless) {
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            }
+            else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
 
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
+            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                indices.graphicsFamily = i;
+            }
 
-        if (presentSupport) {
-            indices.presentFamily = i;
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
         }
 
-        if (indices.isComplete()) {
-            break;
+        // a family without graphics and compute is usually backed by a dedicated DMA engine
+        if (!indices.transferFamily.has_value() &&
+            (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+            !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            indices.transferFamily = i;
         }
 
         i++;
@@ -457,12 +700,20 @@ void VulkanBase::createLogicalDevice()
 {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+    VkPhysicalDeviceFeatures supportedFeatures{};
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     VkDeviceCreateInfo createInfo{};
     float queuePriority = 1.0f;
     std::set<uint32_t> uniqueQueueFamilies{indices.graphicsFamily.value(), indices.presentFamily.value()};
     VkDeviceQueueCreateInfo queueCreateInfo{};
+    std::vector<const char*> extensions;
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
 
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -475,10 +726,45 @@ void VulkanBase::createLogicalDevice()
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+    // cooked textures fall back to RGBA8 without it
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    textureCompressionBCSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+
+    if (!headless) {
+        extensions = deviceExtensions;
+    }
+
+    timelineSemaphoreSupported = checkTimelineSemaphoreSupport(physicalDevice);
+
+    if (timelineSemaphoreSupported) {
+        extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+        createInfo.pNext = &timelineFeatures;
+    }
+
+    descriptorIndexingSupported = checkDescriptorIndexingSupport(physicalDevice);
+
+    if (descriptorIndexingSupported) {
+        extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.pNext = const_cast<void*>(createInfo.pNext);
+        createInfo.pNext = &indexingFeatures;
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.ppEnabledExtensionNames = extensions.data();
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
         createInfo.ppEnabledLayerNames = validationLayers.data();
@@ -493,6 +779,18 @@ void VulkanBase::createLogicalDevice()
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+    if (indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+
+        uploadQueueFamilies.push_back(indices.graphicsFamily.value());
+        uploadQueueFamilies.push_back(indices.transferFamily.value());
+    }
+    else {
+        transferQueue = graphicsQueue;
+    }
+
+    deviceQueueFamilies = indices;
 }
 
 SwapChainSupportDetails VulkanBase::querySwapChainSupport(VkPhysicalDevice device)
@@ -616,12 +914,16 @@ void VulkanBase::createSwapChain()
         throw std::runtime_error("failed to create swap chain!");
     }
 
+    // frames submitted so far may still render to or present the old images,
+    // the old swap chain and its views go once those frames have retired
     if (oldSwapChain != VK_NULL_HANDLE) {
-        for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            vkDestroyImageView(device, swapChainImageViews[i], nullptr);
-        }
+        deletionQueue.push(frameTimeline.submittedValue(), [this, oldSwapChain, oldImageViews = swapChainImageViews]() {
+            for (VkImageView imageView : oldImageViews) {
+                vkDestroyImageView(device, imageView, nullptr);
+            }
 
-        vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+            vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+        });
     }
 
     vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
@@ -633,12 +935,31 @@ void VulkanBase::createSwapChain()
     swapChainExtent = extent;
 }
 
+void VulkanBase::createHeadlessImages()
+{
+    swapChainImages.resize(HEADLESS_IMAGE_COUNT);
+    headlessImageMemory.resize(HEADLESS_IMAGE_COUNT);
+
+    for (uint32_t i = 0; i < HEADLESS_IMAGE_COUNT; i++) {
+        createImage(headlessExtent.width, headlessExtent.height, 1,
+                    VK_FORMAT_B8G8R8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    swapChainImages[i], headlessImageMemory[i]);
+    }
+
+    minImageCount = HEADLESS_IMAGE_COUNT - 1;
+    swapChainImageCount = HEADLESS_IMAGE_COUNT;
+    swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    swapChainExtent = headlessExtent;
+}
+
 void VulkanBase::createImageViews()
 {
     swapChainImageViews.resize(swapChainImages.size());
 
     for (size_t i = 0; i < swapChainImages.size(); i++) {
-        swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat);
+        swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, 1);
     }
 }
 
@@ -656,18 +977,29 @@ void VulkanBase::createCommandPool()
     }
 }
 
-void VulkanBase::createCommandBuffers()
+void VulkanBase::createFrameContexts()
 {
-    commandBuffers.resize(swapChainFramebuffers.size());
+    VkCommandPoolCreateInfo poolInfo{};
     VkCommandBufferAllocateInfo allocInfo{};
 
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = deviceQueueFamilies.graphicsFamily.value();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = commandPool;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    allocInfo.commandBufferCount = 1;
+
+    for (auto& frame : frames) {
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &frame.commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame command pool!");
+        }
 
-    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers!");
+        allocInfo.commandPool = frame.commandPool;
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, &frame.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
     }
 }
 
@@ -681,20 +1013,18 @@ void VulkanBase::recreateSwapChain()
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(device);
+    // no device wait, everything the old swap chain owns is retired with the frames using it
+    deletionQueue.push(frameTimeline.submittedValue(), [this, oldFramebuffers = swapChainFramebuffers]() {
+        for (VkFramebuffer framebuffer : oldFramebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+    });
 
     createSwapChain();
 
     createImageViews();
 
-    for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
-        vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
-    }
     createFramebuffers();
-
-    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
-    createCommandBuffers();
 }
 
 void VulkanBase::cleanupSwapChain()
@@ -703,8 +1033,6 @@ void VulkanBase::cleanupSwapChain()
         vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
     }
 
-    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
     vkDestroyRenderPass(device, renderPass, nullptr);
 
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
@@ -716,9 +1044,6 @@ void VulkanBase::cleanupSwapChain()
 
 uint32_t VulkanBase::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 {
-    VkPhysicalDeviceMemoryProperties memProperties{};
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
     for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
         if ((typeFilter & (1 << i)) &&
             (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
@@ -733,60 +1058,193 @@ void VulkanBase::createBuffer(VkDeviceSize size,
                               VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags properties,
                               VkBuffer& buffer,
-                              VkDeviceMemory& bufferMemory)
+                              Allocation& bufferMemory)
 {
     VkBufferCreateInfo bufferInfo{};
     VkMemoryRequirements memRequirements{};
-    VkMemoryAllocateInfo allocInfo{};
 
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    // written on the transfer queue and read on the graphics queue
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && !uploadQueueFamilies.empty()) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(uploadQueueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = uploadQueueFamilies.data();
+    }
+
     if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer!");
     }
 
     vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    bufferMemory = memoryAllocator.allocate(memRequirements,
+                                            findMemoryType(memRequirements.memoryTypeBits, properties),
+                                            true);
+
+    vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
+}
+
+void VulkanBase::destroyBuffer(VkBuffer buffer, Allocation& bufferMemory)
+{
+    vkDestroyBuffer(device, buffer, nullptr);
+    memoryAllocator.free(bufferMemory);
+}
+
+void VulkanBase::deferDestroyBuffer(VkBuffer buffer, Allocation bufferMemory)
+{
+    deletionQueue.push([this, buffer, bufferMemory]() mutable {
+        destroyBuffer(buffer, bufferMemory);
+    });
+}
+
+void VulkanBase::createStagingRing()
+{
+    createBuffer(STAGING_RING_SIZE,
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingRingBuffer,
+                 stagingRingMemory);
+
+    stagingRing.init(stagingRingBuffer, stagingRingMemory.mapped, STAGING_RING_SIZE);
+}
+
+void VulkanBase::createPipelineCache()
+{
+    VkPipelineCacheCreateInfo cacheInfo{};
+    VkPipelineCacheHeaderVersionOne header{};
+    std::vector<char> data;
+    std::ifstream file(PIPELINE_CACHE_FILE, std::ios::ate | std::ios::binary);
+
+    if (file.is_open()) {
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(data.data(), data.size());
+    }
+
+    // a cache written by another driver or device is useless, start from scratch
+    if (data.size() >= sizeof(header)) {
+        memcpy(&header, data.data(), sizeof(header));
+
+        if (header.headerSize < sizeof(header) ||
+            header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            header.vendorID != deviceProperties.vendorID ||
+            header.deviceID != deviceProperties.deviceID ||
+            memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            data.clear();
+        }
+    }
+    else {
+        data.clear();
+    }
+
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    pipelineCacheLoadedSize = data.size();
+}
+
+void VulkanBase::savePipelineCache()
+{
+    size_t size = 0;
+    std::vector<char> data;
+    std::string tmpFile = std::string(PIPELINE_CACHE_FILE) + ".tmp";
+
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return;
+    }
+
+    data.resize(size);
+
+    if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    // write a temporary file and rename it, so a crash never leaves a truncated cache behind
+    {
+        std::ofstream file(tmpFile, std::ios::binary | std::ios::trunc);
+
+        if (!file.write(data.data(), size)) {
+            std::cerr << "failed to write pipeline cache!" << std::endl;
+            return;
+        }
+    }
+
+    if (std::rename(tmpFile.c_str(), PIPELINE_CACHE_FILE) != 0) {
+        std::cerr << "failed to replace pipeline cache!" << std::endl;
+        std::remove(tmpFile.c_str());
+    }
+}
+
+// Copies data into staging memory that stays valid until the pending upload batch completes
+StagingRegion VulkanBase::stageData(const void* data, VkDeviceSize size)
+{
+    StagingRegion region{};
+
+    if (size > stagingRing.capacity()) {
+        // oversized uploads get a buffer of their own, released with their batch
+        VkBuffer buffer;
+        Allocation bufferMemory;
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
+        createBuffer(size,
+                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     buffer,
+                     bufferMemory);
+
+        uploadQueue.onComplete([this, buffer, bufferMemory]() mutable {
+            destroyBuffer(buffer, bufferMemory);
+        });
+
+        region.buffer = buffer;
+        region.data = bufferMemory.mapped;
+    }
+    else {
+        while (!stagingRing.allocate(size, STAGING_ALIGNMENT, uploadQueue.currentTicket(), region)) {
+            // ring is full, wait for the batch holding its oldest region
+            uploadQueue.wait(stagingRing.oldestTicket());
+            stagingRing.release(uploadQueue.getCompletedTicket());
+        }
     }
 
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+    memcpy(region.data, data, static_cast<size_t>(size));
+
+    return region;
 }
 
-void VulkanBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+// Recorded into the pending upload batch, done once uploadQueue.currentTicket() completes
+void VulkanBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = uploadQueue.getCommandBuffer();
     VkBufferCopy copyRegion{};
 
+    copyRegion.srcOffset = srcOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
-void VulkanBase::createImage(uint32_t width, uint32_t height,
+void VulkanBase::createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
                              VkFormat format, VkImageTiling tiling,
                              VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-                             VkImage& image, VkDeviceMemory& imageMemory)
+                             VkImage& image, Allocation& imageMemory)
 {
     VkImageCreateInfo imageInfo{};
     VkMemoryRequirements memRequirements{};
-    VkMemoryAllocateInfo allocInfo{};
 
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
@@ -795,21 +1253,36 @@ void VulkanBase::createImage(uint32_t width, uint32_t height,
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && !uploadQueueFamilies.empty()) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(uploadQueueFamilies.size());
+        imageInfo.pQueueFamilyIndices = uploadQueueFamilies.data();
+    }
+
     if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image!");
     }
 
     vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    imageMemory = memoryAllocator.allocate(memRequirements,
+                                           findMemoryType(memRequirements.memoryTypeBits, properties),
+                                           tiling == VK_IMAGE_TILING_LINEAR);
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
+    vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
+}
+
+void VulkanBase::destroyImage(VkImage image, Allocation& imageMemory)
+{
+    vkDestroyImage(device, image, nullptr);
+    memoryAllocator.free(imageMemory);
+}
 
-    vkBindImageMemory(device, image, imageMemory, 0);
+void VulkanBase::deferDestroyImage(VkImage image, Allocation imageMemory)
+{
+    deletionQueue.push([this, image, imageMemory]() mutable {
+        destroyImage(image, imageMemory);
+    });
 }
 
 VkCommandBuffer VulkanBase::beginSingleTimeCommands()
@@ -833,28 +1306,39 @@ VkCommandBuffer VulkanBase::beginSingleTimeCommands()
     return commandBuffer;
 }
 
+// Only waits for this submission instead of draining the whole graphics queue
 void VulkanBase::endSingleTimeCommands(VkCommandBuffer commandBuffer)
 {
     VkSubmitInfo submitInfo{};
+    VkFenceCreateInfo fenceInfo{};
+    VkFence fence;
 
     vkEndCommandBuffer(commandBuffer);
 
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create fence!");
+    }
+
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+    vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
 
+    vkDestroyFence(device, fence, nullptr);
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
 void VulkanBase::transitionImageLayout(VkImage image,
                                        VkFormat format,
                                        VkImageLayout oldLayout,
-                                       VkImageLayout newLayout)
+                                       VkImageLayout newLayout,
+                                       uint32_t mipLevels)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = uploadQueue.getCommandBuffer();
     VkPipelineStageFlags sourceStage;
     VkPipelineStageFlags destinationStage;
     VkImageMemoryBarrier barrier{};
@@ -867,7 +1351,7 @@ void VulkanBase::transitionImageLayout(VkImage image,
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -884,6 +1368,12 @@ void VulkanBase::transitionImageLayout(VkImage image,
 
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        // a transfer only queue can't name shader stages, the readers wait for the upload ticket instead
+        if (uploadQueue.getQueueFamilyIndex() != deviceQueueFamilies.graphicsFamily.value()) {
+            barrier.dstAccessMask = 0;
+            destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
     }
     else {
         throw std::invalid_argument("unsupported layout transition!");
@@ -895,21 +1385,19 @@ void VulkanBase::transitionImageLayout(VkImage image,
                          0, nullptr,
                          0, nullptr,
                          1, &barrier);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
-void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset, uint32_t mipLevel)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkCommandBuffer commandBuffer = uploadQueue.getCommandBuffer();
     VkBufferImageCopy region{};
 
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.mipLevel = mipLevel;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
 
@@ -922,11 +1410,109 @@ void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t widt
                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                            1,
                            &region);
+}
+
+bool VulkanBase::canBlitMipmaps(VkFormat format)
+{
+    VkFormatProperties formatProperties{};
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    // blits need a graphics queue
+    if (uploadQueue.getQueueFamilyIndex() != deviceQueueFamilies.graphicsFamily.value()) {
+        return false;
+    }
+
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
 
-    endSingleTimeCommands(commandBuffer);
+    return (formatProperties.optimalTilingFeatures & required) == required;
+}
+
+void VulkanBase::generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    VkCommandBuffer commandBuffer = uploadQueue.getCommandBuffer();
+    VkImageMemoryBarrier barrier{};
+    int32_t mipWidth = static_cast<int32_t>(width);
+    int32_t mipHeight = static_cast<int32_t>(height);
+
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    // level i - 1 is the source of level i, then done
+    for (uint32_t i = 1; i < mipLevels; i++) {
+        VkImageBlit blit{};
+
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+
+        mipWidth = std::max(mipWidth / 2, 1);
+        mipHeight = std::max(mipHeight / 2, 1);
+
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(commandBuffer,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit,
+                       VK_FILTER_LINEAR);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0,
+                             0, nullptr,
+                             0, nullptr,
+                             1, &barrier);
+    }
+
+    // the last level was only written
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
 }
 
-VkImageView VulkanBase::createImageView(VkImage image, VkFormat format)
+VkImageView VulkanBase::createImageView(VkImage image, VkFormat format, uint32_t mipLevels)
 {
     VkImageViewCreateInfo viewInfo{};
     VkImageView imageView;
@@ -937,7 +1523,7 @@ VkImageView VulkanBase::createImageView(VkImage image, VkFormat format)
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
     
@@ -963,7 +1549,8 @@ void VulkanBase::createRenderPass()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // PRESENT_SRC needs the swap chain extension, headless images end up ready for readback
+    colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -1,18 +1,38 @@
 #ifndef _VULKAN_BASE_H_
 #define _VULKAN_BASE_H_
 
+#include "CommandRecorder.h"
+#include "CpuProfiler.h"
+#include "DeletionQueue.h"
+#include "FrameTimeline.h"
+#include "GpuProfiler.h"
+#include "MemoryAllocator.h"
+#include "StagingRing.h"
+#include "UploadQueue.h"
+
 #include <vulkan/vulkan.h>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <array>
+#include <atomic>
 #include <cstdlib>
 #include <glm/glm.hpp>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+// offscreen images standing in for the swap chain in headless mode
+constexpr uint32_t HEADLESS_IMAGE_COUNT = 3;
+// upper bound of threads recording secondary command buffers
+constexpr uint32_t MAX_RECORD_THREADS = 4;
+constexpr VkDeviceSize STAGING_RING_SIZE = 16 * 1024 * 1024;
+// keeps staged texel data aligned for any format up to 16 bytes per texel or block
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+// pipeline cache saved on exit and loaded on the next start
+constexpr const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"};
@@ -31,6 +51,8 @@ struct deletePwindow {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // transfer only family, used for uploads when the device has one
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete()
     {
@@ -39,6 +61,13 @@ struct QueueFamilyIndices {
     }
 };
 
+// Command memory of one frame in flight, recycled as a whole once the frame's timeline value has completed
+struct FrameContext {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    uint64_t timelineValue = 0; // of the last submission, 0 before the first
+};
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -49,25 +78,49 @@ class VulkanBase {
 public:
     std::unique_ptr<GLFWwindow, deletePwindow> pWindow;
     VkInstance instance;
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties deviceProperties{};
+    VkPhysicalDeviceMemoryProperties memProperties{};
+    MemoryAllocator memoryAllocator;
     VkDevice device; //logical device
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
+    QueueFamilyIndices deviceQueueFamilies;
+    // orders frames, frameTimeline.isComplete(value) tells whether a frame has retired,
+    // uploads are tracked by uploadQueue's tickets
+    FrameTimeline frameTimeline;
+    bool timelineSemaphoreSupported = false;
+    bool textureCompressionBCSupported = false;
+    // update-after-bind sampled image arrays indexed by push constants, for ImGui's bindless textures
+    bool descriptorIndexingSupported = false;
+    // resources replaced at runtime, destroyed once the frames that used them have retired
+    DeletionQueue deletionQueue;
+    UploadQueue uploadQueue;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    size_t pipelineCacheLoadedSize = 0; // bytes reused from the cache file, 0 on a cold start
+    StagingRing stagingRing;
     VkAllocationCallbacks* allocator = nullptr;
     uint32_t minImageCount;
     uint32_t swapChainImageCount;
-    VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
-    bool framebufferResized = false;
+    VkCommandPool commandPool; // single time commands
+    std::array<FrameContext, MAX_FRAMES_IN_FLIGHT> frames;
+    CommandRecorder commandRecorder;
+    GpuProfiler gpuProfiler;
+    std::atomic<bool> framebufferResized{false};
+    // when set, prepareFrame/submitFrame only flag swapChainOutOfDate and the
+    // thread owning the window calls recreateSwapChain
+    bool deferSwapChainRecreation = false;
+    std::atomic<bool> swapChainOutOfDate{false};
     VkRenderPass renderPass;
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkExtent2D swapChainExtent;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
     bool enableValidationLayers;
+    // no window, surface or swap chain, frames are rendered into an offscreen image ring
+    bool headless = false;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::vector<VkImage> swapChainImages;
@@ -75,7 +128,7 @@ public:
     std::vector<VkImageView> swapChainImageViews;
     size_t currentFrame = 0;
 
-    VulkanBase(uint32_t width, uint32_t height, const std::string, bool enableValidationLayers);
+    VulkanBase(uint32_t width, uint32_t height, const std::string, bool enableValidationLayers, bool headless = false);
     ~VulkanBase();
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -86,33 +139,55 @@ public:
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     bool prepareFrame(uint32_t* imageIndex);
     bool submitFrame(uint32_t imageIndex);
-    
-protected:
-    void createBuffer(VkDeviceSize size,
-                      VkBufferUsageFlags usage,
-                      VkMemoryPropertyFlags properties,
-                      VkBuffer& buffer,
-                      VkDeviceMemory& bufferMemory);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-    void createImage(uint32_t width, uint32_t height,
+    bool windowShouldClose();
+    void pollEvents();
+
+    // upload interface for subsystems like TextureLoader, transfers and barriers are recorded
+    // into the upload queue's batch, i.e. on the thread submitting frames
+    StagingRegion stageData(const void* data, VkDeviceSize size);
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
                      VkFormat format, VkImageTiling tiling,
                      VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-                     VkImage& image, VkDeviceMemory& imageMemory);
+                     VkImage& image, Allocation& imageMemory);
+    void destroyImage(VkImage image, Allocation& imageMemory);
+    // destroyed once the frame being recorded has retired
+    void deferDestroyImage(VkImage image, Allocation imageMemory);
     void transitionImageLayout(VkImage image,
                                VkFormat format,
                                VkImageLayout oldLayout,
-                               VkImageLayout newLayout);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    VkImageView createImageView(VkImage image, VkFormat format);
+                               VkImageLayout newLayout,
+                               uint32_t mipLevels);
+    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0, uint32_t mipLevel = 0);
+    // the upload queue can fill the levels below 0 by blits, i.e. it is a graphics queue and
+    // format supports linear filtering
+    bool canBlitMipmaps(VkFormat format);
+    // records blits from level 0 (in TRANSFER_DST_OPTIMAL) to every other level, leaves the
+    // image in SHADER_READ_ONLY_OPTIMAL
+    void generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+    VkImageView createImageView(VkImage image, VkFormat format, uint32_t mipLevels);
+
+protected:
+    void createBuffer(VkDeviceSize size,
+                      VkBufferUsageFlags usage,
+                      VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer,
+                      Allocation& bufferMemory);
+    void destroyBuffer(VkBuffer buffer, Allocation& bufferMemory);
+    // destroyed once the frame being recorded has retired
+    void deferDestroyBuffer(VkBuffer buffer, Allocation bufferMemory);
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0);
     VkViewport createViewport(float width, float height, float minDepth, float maxDepth);
     VkRect2D createRect2D(int32_t width, int32_t height, int32_t offsetX, int32_t offsetY);
     void initVulkan();
+    void recreateSwapChain();
 
 private:
     void initWindow(uint32_t width, uint32_t height, const std::string title);
     void createInstance();
     bool checkValidationLayerSupport();
     std::vector<const char*> getRequiredExtensions();
+    bool checkTimelineSemaphoreSupport(VkPhysicalDevice device);
+    bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
                                                         VkDebugUtilsMessageTypeFlagsEXT messageType,
                                                         const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
@@ -125,15 +200,28 @@ private:
     void createSurface();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
     void createSwapChain();
+    void createHeadlessImages();
     void createImageViews();
     void createCommandPool();
-    void createCommandBuffers();
+    void createFrameContexts();
     void cleanupSwapChain();
     void createRenderPass();
     void createFramebuffers();
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     void createSyncObjects();
-    void recreateSwapChain();
+    void createStagingRing();
+    void createPipelineCache();
+    void savePipelineCache();
+
+    // queue families that share resources written by the upload queue
+    std::vector<uint32_t> uploadQueueFamilies;
+    // VK_KHR_get_physical_device_properties2 is enabled, needed to query timeline semaphore support
+    bool physicalDeviceProperties2 = false;
+    VkExtent2D headlessExtent{};
+    std::vector<Allocation> headlessImageMemory;
+    uint32_t nextHeadlessImage = 0;
+    VkBuffer stagingRingBuffer = VK_NULL_HANDLE;
+    Allocation stagingRingMemory;
 };
 
 #endif
@@ -0,0 +1,364 @@
+#include "BlockEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t BLOCK_TEXELS = 16;
+// BC7 interpolation weights of 4 bit indices, out of 64
+constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : out(out) {}
+
+    // least significant bit first
+    void write(uint32_t value, uint32_t bits)
+    {
+        for (uint32_t i = 0; i < bits; i++, position++) {
+            if ((value >> i) & 1) {
+                out[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+            }
+        }
+    }
+
+private:
+    uint8_t* out;
+    uint32_t position = 0;
+};
+
+// Endpoints along the principal axis of the first channels of a block, found by power
+// iteration on the covariance from the channel that varies most.
+void fitEndpoints(const uint8_t* block, uint32_t channels, float* lo, float* hi)
+{
+    float mean[4]{}, covariance[4][4]{}, axis[4]{};
+    float minT = 0.0f, maxT = 0.0f;
+    uint32_t widest = 0;
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            mean[c] += block[i * 4 + c] / static_cast<float>(BLOCK_TEXELS);
+        }
+    }
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        for (uint32_t a = 0; a < channels; a++) {
+            for (uint32_t b = 0; b < channels; b++) {
+                covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+            }
+        }
+    }
+
+    for (uint32_t c = 1; c < channels; c++) {
+        if (covariance[c][c] > covariance[widest][widest]) {
+            widest = c;
+        }
+    }
+
+    axis[widest] = 1.0f;
+
+    for (uint32_t iteration = 0; iteration < 8; iteration++) {
+        float next[4]{};
+        float length = 0.0f;
+
+        for (uint32_t a = 0; a < channels; a++) {
+            for (uint32_t b = 0; b < channels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+
+            length += next[a] * next[a];
+        }
+
+        // a flat block, both endpoints are the mean
+        if (length == 0.0f) {
+            break;
+        }
+
+        for (uint32_t c = 0; c < channels; c++) {
+            axis[c] = next[c] / std::sqrt(length);
+        }
+    }
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        float t = 0.0f;
+
+        for (uint32_t c = 0; c < channels; c++) {
+            t += (block[i * 4 + c] - mean[c]) * axis[c];
+        }
+
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for (uint32_t c = 0; c < channels; c++) {
+        lo[c] = std::clamp(mean[c] + minT * axis[c], 0.0f, 255.0f);
+        hi[c] = std::clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f);
+    }
+}
+
+int squaredDistance(const uint8_t* texel, const int* color, uint32_t channels)
+{
+    int distance = 0;
+
+    for (uint32_t c = 0; c < channels; c++) {
+        int d = texel[c] - color[c];
+        distance += d * d;
+    }
+
+    return distance;
+}
+
+uint32_t nearestColor(const uint8_t* texel, const int (*palette)[4], uint32_t paletteSize, uint32_t channels)
+{
+    uint32_t best = 0;
+    int bestDistance = std::numeric_limits<int>::max();
+
+    for (uint32_t i = 0; i < paletteSize; i++) {
+        int distance = squaredDistance(texel, palette[i], channels);
+
+        if (distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+uint16_t packRgb565(const float* color)
+{
+    uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+    uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+    uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRgb565(uint16_t packed, int* color)
+{
+    int r = packed >> 11, g = (packed >> 5) & 0x3f, b = packed & 0x1f;
+
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+    color[3] = 255;
+}
+
+// the 4 color mode, color0 > color1, alpha is left out
+void encodeColorBlock(const uint8_t* block, uint8_t* out)
+{
+    float lo[4]{}, hi[4]{};
+    uint16_t color0 = 0, color1 = 0;
+    uint32_t indices = 0;
+    int palette[4][4]{};
+
+    fitEndpoints(block, 3, lo, hi);
+
+    color0 = packRgb565(hi);
+    color1 = packRgb565(lo);
+
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    // equal endpoints can't be ordered, index 0 everywhere reads color0 in either mode
+    if (color0 != color1) {
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+
+        for (uint32_t c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            indices |= nearestColor(block + i * 4, palette, 4, 3) << (2 * i);
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        out[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+    }
+}
+
+// BC4 with alpha0 > alpha1, the 8 value mode
+void encodeAlphaBlock(const uint8_t* block, uint8_t* out)
+{
+    int alpha0 = 0, alpha1 = 255;
+    uint64_t indices = 0;
+    int palette[8][4]{};
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        alpha0 = std::max<int>(alpha0, block[i * 4 + 3]);
+        alpha1 = std::min<int>(alpha1, block[i * 4 + 3]);
+    }
+
+    if (alpha0 > alpha1) {
+        palette[0][0] = alpha0;
+        palette[1][0] = alpha1;
+
+        for (int i = 1; i < 7; i++) {
+            palette[i + 1][0] = ((7 - i) * alpha0 + i * alpha1) / 7;
+        }
+
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            indices |= static_cast<uint64_t>(nearestColor(block + i * 4 + 3, palette, 8, 1)) << (3 * i);
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(alpha0);
+    out[1] = static_cast<uint8_t>(alpha1);
+
+    for (uint32_t i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+    }
+}
+
+// 7 bit channels sharing a p-bit, the p-bit closer to the fitted endpoint wins
+void quantizeBC7Endpoint(const float* endpoint, uint32_t* channels, uint32_t& pBit)
+{
+    float bestError = std::numeric_limits<float>::max();
+
+    for (uint32_t p = 0; p < 2; p++) {
+        uint32_t quantized[4]{};
+        float error = 0.0f;
+
+        for (uint32_t c = 0; c < 4; c++) {
+            quantized[c] = static_cast<uint32_t>(std::clamp<long>(std::lround((endpoint[c] - p) / 2.0f), 0, 127));
+
+            float d = static_cast<float>((quantized[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            std::copy(quantized, quantized + 4, channels);
+        }
+    }
+}
+
+} // namespace
+
+void encodeBC1Block(const uint8_t* block, uint8_t* out)
+{
+    encodeColorBlock(block, out);
+}
+
+void encodeBC3Block(const uint8_t* block, uint8_t* out)
+{
+    encodeAlphaBlock(block, out);
+    encodeColorBlock(block, out + 8);
+}
+
+void encodeBC7Block(const uint8_t* block, uint8_t* out)
+{
+    float lo[4]{}, hi[4]{};
+    uint32_t endpoints[2][4]{}, pBits[2]{};
+    int palette[16][4]{};
+    uint32_t indices[BLOCK_TEXELS]{};
+    BitWriter writer(out);
+
+    fitEndpoints(block, 4, lo, hi);
+
+    quantizeBC7Endpoint(lo, endpoints[0], pBits[0]);
+    quantizeBC7Endpoint(hi, endpoints[1], pBits[1]);
+
+    for (uint32_t i = 0; i < 16; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            int e0 = static_cast<int>((endpoints[0][c] << 1) | pBits[0]);
+            int e1 = static_cast<int>((endpoints[1][c] << 1) | pBits[1]);
+
+            palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+        }
+    }
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        indices[i] = nearestColor(block + i * 4, palette, 16, 4);
+    }
+
+    // the anchor index drops its top bit, the weights are symmetric so swapping the
+    // endpoints and flipping every index decodes the same
+    if (indices[0] >= 8) {
+        std::swap(endpoints[0], endpoints[1]);
+        std::swap(pBits[0], pBits[1]);
+
+        for (auto& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    std::memset(out, 0, 16);
+
+    writer.write(1 << 6, 7);
+
+    for (uint32_t c = 0; c < 4; c++) {
+        writer.write(endpoints[0][c], 7);
+        writer.write(endpoints[1][c], 7);
+    }
+
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+
+    writer.write(indices[0], 3);
+
+    for (uint32_t i = 1; i < BLOCK_TEXELS; i++) {
+        writer.write(indices[i], 4);
+    }
+}
+
+std::vector<uint8_t> encodeLevel(VkFormat format, const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> data;
+    uint8_t block[BLOCK_TEXELS * 4]{};
+    void (*encodeBlock)(const uint8_t*, uint8_t*) = nullptr;
+    size_t blockSize = 16;
+    uint8_t* out = nullptr;
+
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        data.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        return data;
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        encodeBlock = encodeBC1Block;
+        blockSize = 8;
+        break;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        encodeBlock = encodeBC3Block;
+        break;
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        encodeBlock = encodeBC7Block;
+        break;
+    default:
+        throw std::runtime_error("unsupported cooked texture format!");
+    }
+
+    data.resize(static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize);
+    out = data.data();
+
+    for (uint32_t blockY = 0; blockY < height; blockY += 4) {
+        for (uint32_t blockX = 0; blockX < width; blockX += 4, out += blockSize) {
+            for (uint32_t y = 0; y < 4; y++) {
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t srcX = std::min(blockX + x, width - 1);
+                    uint32_t srcY = std::min(blockY + y, height - 1);
+
+                    std::memcpy(block + (y * 4 + x) * 4, pixels + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+                }
+            }
+
+            encodeBlock(block, out);
+        }
+    }
+
+    return data;
+}
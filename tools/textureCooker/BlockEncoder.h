@@ -0,0 +1,21 @@
+#ifndef _BLOCK_ENCODER_H_
+#define _BLOCK_ENCODER_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Block encoders for the cooked formats. A block is 4x4 RGBA8 texels, row major, and is
+// encoded in the space its values are in, sRGB values stay sRGB.
+void encodeBC1Block(const uint8_t* block, uint8_t* out);
+// BC4 alpha followed by a BC1 color block
+void encodeBC3Block(const uint8_t* block, uint8_t* out);
+// mode 6 only: one RGBA subset, 7 bit endpoints with p-bits and 4 bit indices
+void encodeBC7Block(const uint8_t* block, uint8_t* out);
+
+// Encodes a width x height RGBA8 level, edge texels are repeated to fill partial blocks.
+// R8G8B8A8 is copied as is.
+std::vector<uint8_t> encodeLevel(VkFormat format, const uint8_t* pixels, uint32_t width, uint32_t height);
+
+#endif
@@ -0,0 +1,167 @@
+#include "BlockEncoder.h"
+#include "CookedTexture.h"
+#include "MipChain.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct CookedFormat {
+    const char* name;
+    VkFormat format;
+};
+
+constexpr CookedFormat COOKED_FORMATS[] = {
+    {"bc1", VK_FORMAT_BC1_RGBA_SRGB_BLOCK},
+    {"bc3", VK_FORMAT_BC3_SRGB_BLOCK},
+    {"bc7", VK_FORMAT_BC7_SRGB_BLOCK},
+};
+
+static void printUsage()
+{
+    std::cout << "usage: TextureCooker INPUT OUTPUT [--format auto|bc1|bc3|bc7] [--no-fallback]" << std::endl;
+}
+
+static bool isOpaque(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+        if (pixels[i * 4 + 3] != 255) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void writeCookedTexture(const std::string& path, const MipChain& chain, const std::vector<VkFormat>& formats)
+{
+    CookedTextureHeader header{};
+    std::vector<CookedPayload> payloads(formats.size());
+    std::vector<std::vector<uint8_t>> levels;
+    uint64_t offset = sizeof(CookedTextureHeader) + formats.size() * sizeof(CookedPayload);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    const char padding[COOKED_DATA_ALIGNMENT]{};
+
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path + "!");
+    }
+
+    if (chain.levels.size() > COOKED_MAX_MIP_LEVELS) {
+        throw std::runtime_error("image too large to cook!");
+    }
+
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.width = chain.levels[0].width;
+    header.height = chain.levels[0].height;
+    header.mipLevels = static_cast<uint32_t>(chain.levels.size());
+    header.payloadCount = static_cast<uint32_t>(formats.size());
+
+    for (size_t i = 0; i < formats.size(); i++) {
+        payloads[i].format = formats[i];
+
+        for (size_t level = 0; level < chain.levels.size(); level++) {
+            const MipLevel& mip = chain.levels[level];
+
+            offset = (offset + COOKED_DATA_ALIGNMENT - 1) / COOKED_DATA_ALIGNMENT * COOKED_DATA_ALIGNMENT;
+
+            levels.push_back(encodeLevel(formats[i], chain.data.data() + mip.offset, mip.width, mip.height));
+            payloads[i].levels[level] = CookedLevel{offset, levels.back().size()};
+            offset += levels.back().size();
+        }
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(payloads.data()), payloads.size() * sizeof(CookedPayload));
+
+    for (auto& level : levels) {
+        file.write(padding, (COOKED_DATA_ALIGNMENT - file.tellp() % COOKED_DATA_ALIGNMENT) % COOKED_DATA_ALIGNMENT);
+        file.write(reinterpret_cast<const char*>(level.data()), level.size());
+    }
+
+    if (!file) {
+        throw std::runtime_error("failed to write " + path + "!");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string formatName = "auto";
+    bool fallback = true;
+    std::vector<std::string> paths;
+    std::vector<VkFormat> formats;
+    int texWidth = 0, texHeight = 0, texChannels = 0;
+    stbi_uc* pixels = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            formatName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-fallback") == 0) {
+            fallback = false;
+        }
+        else if (argv[i][0] != '-' && paths.size() < 2) {
+            paths.push_back(argv[i]);
+        }
+        else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (paths.size() != 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        pixels = stbi_load(paths[0].c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+        if (!pixels) {
+            throw std::runtime_error("failed to load " + paths[0] + "!");
+        }
+
+        // BC1 has no alpha in the 4 color mode, translucent images get BC7
+        if (formatName == "auto") {
+            formatName = isOpaque(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight)) ? "bc1" : "bc7";
+        }
+
+        for (auto& format : COOKED_FORMATS) {
+            if (formatName == format.name) {
+                formats.push_back(format.format);
+            }
+        }
+
+        if (formats.empty()) {
+            stbi_image_free(pixels);
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        // for devices without BC support
+        if (fallback) {
+            formats.push_back(VK_FORMAT_R8G8B8A8_SRGB);
+        }
+
+        MipChain chain = buildMipChain(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), true);
+
+        stbi_image_free(pixels);
+
+        writeCookedTexture(paths[1], chain, formats);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << paths[0] << " cooked to " << paths[1] << " as " << formatName << std::endl;
+
+    return EXIT_SUCCESS;
+}